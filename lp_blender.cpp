@@ -1,146 +1,8637 @@
+// -DBLENDER_EMBEDDED=1: the controller build. main() only solves the
+// compiled example image (see runEmbedded()), and everything else, with the
+// iostreams, hash maps and heap-backed globals it needs, is left out.
+#ifndef BLENDER_EMBEDDED
+#define BLENDER_EMBEDDED 0
+#endif
+#if !BLENDER_EMBEDDED
 #include <iostream>
+#endif
 #include <vector>
 #include <string>
-#include <map>
+#include <unordered_map>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstddef>
+#include <memory>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <list>
+#include <cstdint>
+#include <climits>
+#include <limits>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/resource.h>
+#ifdef __linux__
+#include <sys/socket.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#endif
+#include <charconv>
+#include <random>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+#include <chrono>
+#include <fstream>
+#include <sstream>
+#include <cstring>
+#include <cstdio>
+#include <csignal>
+#include <deque>
+#include <condition_variable>
 // Include the necessary header for the CLP solver classes
 #include "ClpSimplex.hpp" 
 #include "OsiClpSolverInterface.hpp" // Or ClpSimplex.hpp for direct use
+#include "ClpEventHandler.hpp"
+#include "ClpPresolve.hpp"
+#include "ClpSolve.hpp"
+#include "ClpDualRowSteepest.hpp"
+#include "ClpPrimalColumnSteepest.hpp"
+#include "ClpInterior.hpp"
+#include "ClpCholeskyBase.hpp"
+// -DBLENDER_WITH_CBC=1: the mixed-integer blend (--mip, see solveMip()); link
+// libCbc and libCgl
+#ifndef BLENDER_WITH_CBC
+#define BLENDER_WITH_CBC 0
+#endif
+#if BLENDER_WITH_CBC
+#include "CbcModel.hpp"
+#endif
+// -DBLENDER_WITH_PARDISO=1: factor the barrier's normal equations with MKL
+// PARDISO (multithreaded) instead of CLP's native Cholesky
+#ifndef BLENDER_WITH_PARDISO
+#define BLENDER_WITH_PARDISO 0
+#endif
+#if BLENDER_WITH_PARDISO
+#include "ClpCholeskyPardiso.hpp"
+#include <mkl_service.h>
+#endif
+// -DBLENDER_WITH_CUDA=1: the PDLP backend (first-order solve on the GPU, see
+// pdlpSolve()); compile this file with nvcc -x cu and link cusparse and cublas
+#ifndef BLENDER_WITH_CUDA
+#define BLENDER_WITH_CUDA 0
+#endif
+#if BLENDER_WITH_CUDA
+#include <cuda_runtime.h>
+#include <cusparse.h>
+#include <cublas_v2.h>
+#endif
+// -DBLENDER_WITH_MPI=1: the distributed batch driver (--distributed, see
+// runDistributedBatch()); build with mpicxx and start the job with mpirun
+#ifndef BLENDER_WITH_MPI
+#define BLENDER_WITH_MPI 0
+#endif
+#if BLENDER_WITH_MPI
+#include <mpi.h>
+#endif
 
 using namespace std;
 
 // --- 1. DATA: Define the input parameters ---
 
 // Global variables or constants for the problem data
-const double TOTAL_BLEND = 100.0;
+constexpr double TOTAL_BLEND = 100.0;
 
 // Feeds and Components
-const vector<string> FEEDS = {"A", "B", "C"};
-const vector<string> COMPONENTS = {"X", "Y"};
+constexpr int NUM_FEEDS = 3;
+constexpr int NUM_COMPONENTS = 2;
+constexpr const char *FEEDS[NUM_FEEDS] = {"A", "B", "C"};
+constexpr const char *COMPONENTS[NUM_COMPONENTS] = {"X", "Y"};
 
 // Cost of each feed ($/unit)
-const map<string, double> COSTS = {
-    {"A", 10.0},
-    {"B", 12.0},
-    {"C", 8.0}
+constexpr double COSTS[NUM_FEEDS] = {10.0, 12.0, 8.0};
+
+// Content of component j in feed i (Fraction)
+//                                                X     Y
+constexpr double CONTENT[NUM_FEEDS][NUM_COMPONENTS] = {{0.60, 0.10},  // A
+                                                       {0.30, 0.50},  // B
+                                                       {0.20, 0.30}}; // C
+
+// Minimum required content in the final blend (Fraction)
+constexpr double REQ_MIN[NUM_COMPONENTS] = {0.40, 0.30};
+
+
+// --- 1a. RECIPES: Fixed-size problem data compiled into a CSC image ---
+
+// A recipe is the problem data of section 1 as one literal type: sizes are
+// template parameters and every table is a fixed-size array, so a recipe can
+// be constexpr. compileRecipe() lays out the same columns, rows and matrix
+// as buildModel() (zero contents dropped) entirely at compile time, and the
+// resulting image lives in read-only data: loading it needs no static
+// initialization, no interning and no heap use on our side. This is what the
+// embedded build (-DBLENDER_EMBEDDED=1) runs.
+template <int NF, int NC>
+struct Recipe {
+    double totalBlend;
+    const char *feeds[NF];
+    const char *components[NC];
+    double cost[NF];
+    double content[NF][NC];
+    double reqMin[NC];
+};
+
+template <int NF, int NC>
+struct CscImage {
+    static constexpr int NUM_COLUMNS = NF;
+    static constexpr int NUM_ROWS = NC + 1;
+    static constexpr int MAX_ELEMENTS = NF * (NC + 1);
+
+    int numElements;
+    CoinBigIndex columnStarts[NF + 1];
+    int rowIndices[MAX_ELEMENTS];
+    double elements[MAX_ELEMENTS];
+    double columnLower[NF];
+    double columnUpper[NF];
+    double objective[NF];
+    double rowLower[NC + 1];
+    double rowUpper[NC + 1];
+};
+
+template <int NF, int NC>
+constexpr bool validRecipe(const Recipe<NF, NC> &recipe) {
+    if (!(recipe.totalBlend > 0.0)) {
+        return false;
+    }
+    for (int j = 0; j < NC; ++j) {
+        if (recipe.reqMin[j] < 0.0 || recipe.reqMin[j] > 1.0) {
+            return false;
+        }
+    }
+    for (int i = 0; i < NF; ++i) {
+        for (int j = 0; j < NC; ++j) {
+            if (recipe.content[i][j] < 0.0 || recipe.content[i][j] > 1.0) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+template <int NF, int NC>
+constexpr CscImage<NF, NC> compileRecipe(const Recipe<NF, NC> &recipe) {
+    CscImage<NF, NC> image{};
+    for (int i = 0; i < NF; ++i) {
+        image.columnLower[i] = 0.0;
+        image.columnUpper[i] = 1.0e+20;
+        image.objective[i] = recipe.cost[i];
+    }
+    image.rowLower[0] = recipe.totalBlend;
+    image.rowUpper[0] = recipe.totalBlend;
+    for (int j = 0; j < NC; ++j) {
+        image.rowLower[j + 1] = recipe.reqMin[j] * recipe.totalBlend;
+        image.rowUpper[j + 1] = 1.0e+20;
+    }
+
+    int next = 0;
+    for (int i = 0; i < NF; ++i) {
+        image.columnStarts[i] = next;
+        image.rowIndices[next] = 0;
+        image.elements[next++] = 1.0;
+        for (int j = 0; j < NC; ++j) {
+            if (recipe.content[i][j] != 0.0) {
+                image.rowIndices[next] = j + 1;
+                image.elements[next++] = recipe.content[i][j];
+            }
+        }
+    }
+    image.columnStarts[NF] = next;
+    image.numElements = next;
+    return image;
+}
+
+// The shipped example as a recipe and its prebuilt image
+constexpr Recipe<NUM_FEEDS, NUM_COMPONENTS> EXAMPLE_RECIPE = {
+    TOTAL_BLEND,
+    {FEEDS[0], FEEDS[1], FEEDS[2]},
+    {COMPONENTS[0], COMPONENTS[1]},
+    {COSTS[0], COSTS[1], COSTS[2]},
+    {{CONTENT[0][0], CONTENT[0][1]}, {CONTENT[1][0], CONTENT[1][1]}, {CONTENT[2][0], CONTENT[2][1]}},
+    {REQ_MIN[0], REQ_MIN[1]},
+};
+static_assert(validRecipe(EXAMPLE_RECIPE), "example recipe out of range");
+
+constexpr CscImage<NUM_FEEDS, NUM_COMPONENTS> EXAMPLE_IMAGE = compileRecipe(EXAMPLE_RECIPE);
+static_assert(EXAMPLE_IMAGE.numElements == 9, "example image should keep every content entry");
+
+
+#if !BLENDER_EMBEDDED  // sections 1b and 1c
+
+// --- 1b. PROBLEM MODEL: Index-addressed problem data ---
+
+// Widens a fraction held as float32 (BlendProblem::narrowContent) back to
+// the double it was narrowed from: the shortest decimal that reads back as
+// the float, read as a double. Fractions up to FLT_DIG significant digits,
+// i.e. as they are written in data files, come back bit for bit.
+inline double widenFraction(float value) {
+    char text[32];
+    char *end = to_chars(text, text + sizeof(text), value).ptr;
+    double wide = 0.0;
+    from_chars(text, end, wide);
+    return wide;
+}
+
+// Read-only view of the problem arrays (layout as in BlendProblem below). The
+// builder works on this, so data can come from a BlendProblem or straight out
+// of a memory-mapped file without being copied.
+struct ProblemView {
+    int numFeeds;
+    int numComponents;
+    int numContent;
+    const double *cost;
+    const double *reqMin;
+    double totalBlend;
+    const int *contentStart;
+    const int *contentComponent;
+    const double *contentFraction;  // null when the fractions are in contentFloat
+    double dropTolerance;
+
+    // Limits; null (and no ratios) means none, as in problems that have none
+    const double *reqMax = nullptr;     // maximum fraction, one per component
+    const double *available = nullptr;  // units, one per feed
+    int numRatios = 0;
+    const double *ratioLow = nullptr;
+    const double *ratioHigh = nullptr;
+    const int *ratioOfTotal = nullptr;
+    const int *ratioStart = nullptr;
+    const int *ratioFeed = nullptr;
+    const int *ratioPart = nullptr;
+
+    const float *contentFloat = nullptr;  // see BlendProblem::narrowContent()
+
+    double fraction(int k) const {
+        return contentFraction ? contentFraction[k] : widenFraction(contentFloat[k]);
+    }
+};
+
+// Which side of a ratio limit a feed is on (BlendProblem::ratioPart is a mask)
+enum RatioPart {
+    RATIO_NUMERATOR = 1,
+    RATIO_DENOMINATOR = 2
+};
+
+// Feeds and components are interned once into dense IDs (0..n-1) and every
+// table is a contiguous array addressed by those IDs, so the builder never
+// looks anything up by name.
+//
+// Content is sparse and feed-major, i.e. laid out like the columns of the
+// constraint matrix: feed i's nonzero fractions are the entries
+// [contentStart[i], contentStart[i + 1]) of contentComponent/contentFraction,
+// sorted by component ID. Fractions with |value| <= dropTolerance are
+// structural zeros and are neither stored nor put into the matrix.
+//
+// Limits use 1.0e+20 for "none": a component's maximum fraction, a feed's
+// availability in units, and ratio limits
+//   ratioLow[r] <= sum_numerator x / sum_denominator x <= ratioHigh[r]
+// (low 0 is no lower limit) whose denominator is the whole blend when
+// ratioOfTotal[r] is set. Limit r's feeds are the entries
+// [ratioStart[r], ratioStart[r + 1]) of ratioFeed/ratioPart, sorted by feed
+// ID, with a RatioPart mask each.
+struct BlendProblem {
+    vector<string> feedNames;        // feed ID -> name
+    vector<string> componentNames;   // component ID -> name
+    unordered_map<string, int> feedIds;
+    unordered_map<string, int> componentIds;
+
+    vector<double> cost;     // $/unit, one per feed
+    vector<double> reqMin;   // minimum fraction, one per component
+    double totalBlend = 0.0;
+
+    vector<int> contentStart = {0};  // numFeeds() + 1 offsets
+    vector<int> contentComponent;    // component ID of each stored fraction
+    vector<double> contentFraction;  // the fraction itself
+    vector<float> contentFloat;      // ... or, after narrowContent(), as float32
+    double dropTolerance = 0.0;
+
+    vector<double> reqMax;     // maximum fraction, one per component
+    vector<double> available;  // units, one per feed
+    vector<double> ratioLow, ratioHigh;
+    vector<int> ratioOfTotal;
+    vector<int> ratioStart = {0};  // numRatios() + 1 offsets
+    vector<int> ratioFeed;
+    vector<int> ratioPart;
+
+    int numFeeds() const { return feedNames.size(); }
+    int numComponents() const { return componentNames.size(); }
+    int numContent() const { return contentComponent.size(); }
+    int numRatios() const { return ratioLow.size(); }
+
+    // Max specs, availability or ratio limits beyond the plain min-spec blend
+    bool hasLimits() const {
+        auto limited = [](double value) { return value < 1.0e+20; };
+        return numRatios() > 0 || any_of(reqMax.begin(), reqMax.end(), limited) ||
+               any_of(available.begin(), available.end(), limited);
+    }
+
+    // Returns the ID of a feed, adding it (cost 0, no content) if it is new.
+    int internFeed(const string &name) {
+        auto found = feedIds.find(name);
+        if (found != feedIds.end()) {
+            return found->second;
+        }
+        int id = feedNames.size();
+        feedIds.emplace(name, id);
+        feedNames.push_back(name);
+        cost.push_back(0.0);
+        available.push_back(1.0e+20);
+        contentStart.push_back(contentStart.back());
+        return id;
+    }
+
+    // Returns the ID of a component, adding it (spec 0) if it is new.
+    int internComponent(const string &name) {
+        auto found = componentIds.find(name);
+        if (found != componentIds.end()) {
+            return found->second;
+        }
+        int id = componentNames.size();
+        componentIds.emplace(name, id);
+        componentNames.push_back(name);
+        reqMin.push_back(0.0);
+        reqMax.push_back(1.0e+20);
+        return id;
+    }
+
+    double fraction(int k) const {
+        return contentFloat.empty() ? contentFraction[k] : widenFraction(contentFloat[k]);
+    }
+
+    // Holds the fractions as float32 instead of double if every one of them
+    // comes back exactly through widenFraction(), which halves the largest
+    // array of a big problem. Only the builders widen them (at matrix load),
+    // so the models are the same; returns whether the content was narrowed.
+    bool narrowContent() {
+        if (!contentFloat.empty() || contentFraction.empty()) {
+            return false;
+        }
+        vector<float> narrow(contentFraction.size());
+        for (size_t k = 0; k < narrow.size(); ++k) {
+            narrow[k] = static_cast<float>(contentFraction[k]);
+            if (widenFraction(narrow[k]) != contentFraction[k]) {
+                return false;
+            }
+        }
+        contentFloat.swap(narrow);
+        vector<double>().swap(contentFraction);
+        return true;
+    }
+
+    // Undoes narrowContent(); the setters below work on doubles
+    void widenContent() {
+        if (contentFloat.empty()) {
+            return;
+        }
+        contentFraction.resize(contentFloat.size());
+        for (size_t k = 0; k < contentFloat.size(); ++k) {
+            contentFraction[k] = widenFraction(contentFloat[k]);
+        }
+        vector<float>().swap(contentFloat);
+    }
+
+    // Sets the fraction of a component in a feed; structural zeros remove the
+    // entry. Filling feeds in ID order and components in ID order is a plain
+    // append, anything else shifts the entries behind it.
+    void setContent(int feed, int component, double fraction) {
+        widenContent();
+        int begin = contentStart[feed];
+        int end = contentStart[feed + 1];
+        int at = lower_bound(contentComponent.begin() + begin, contentComponent.begin() + end,
+                             component) - contentComponent.begin();
+        bool present = at < end && contentComponent[at] == component;
+        bool zero = fabs(fraction) <= dropTolerance;
+
+        if (present && !zero) {
+            contentFraction[at] = fraction;
+            return;
+        }
+        if (present) {
+            contentComponent.erase(contentComponent.begin() + at);
+            contentFraction.erase(contentFraction.begin() + at);
+        } else if (!zero) {
+            contentComponent.insert(contentComponent.begin() + at, component);
+            contentFraction.insert(contentFraction.begin() + at, fraction);
+        } else {
+            return;
+        }
+        int shift = present ? -1 : 1;
+        for (size_t i = feed + 1; i < contentStart.size(); ++i) {
+            contentStart[i] += shift;
+        }
+    }
+
+    // Adds a ratio limit; a feed may be on both sides. With `ofTotal` set
+    // the denominator is ignored.
+    void addRatio(const vector<int> &numerator, const vector<int> &denominator, bool ofTotal,
+                  double low, double high) {
+        vector<pair<int, int>> parts;
+        for (int feed : numerator) {
+            parts.emplace_back(feed, RATIO_NUMERATOR);
+        }
+        if (!ofTotal) {
+            for (int feed : denominator) {
+                parts.emplace_back(feed, RATIO_DENOMINATOR);
+            }
+        }
+        sort(parts.begin(), parts.end());
+        for (const pair<int, int> &part : parts) {
+            if (ratioFeed.size() > size_t(ratioStart.back()) && ratioFeed.back() == part.first) {
+                ratioPart.back() |= part.second;
+            } else {
+                ratioFeed.push_back(part.first);
+                ratioPart.push_back(part.second);
+            }
+        }
+        ratioStart.push_back(ratioFeed.size());
+        ratioLow.push_back(low);
+        ratioHigh.push_back(high);
+        ratioOfTotal.push_back(ofTotal);
+    }
+
+    // Removes a feed and its content; higher feed IDs move down by one, the
+    // same way ClpSimplex::deleteColumns renumbers columns. Ratio limits
+    // lose the feed from their sums.
+    void removeFeed(int feed) {
+        widenContent();
+        int begin = contentStart[feed];
+        int end = contentStart[feed + 1];
+        contentComponent.erase(contentComponent.begin() + begin, contentComponent.begin() + end);
+        contentFraction.erase(contentFraction.begin() + begin, contentFraction.begin() + end);
+        contentStart.erase(contentStart.begin() + feed + 1);
+        for (size_t i = feed + 1; i < contentStart.size(); ++i) {
+            contentStart[i] -= end - begin;
+        }
+
+        int kept = 0;
+        for (int r = 0; r < numRatios(); ++r) {
+            int ratioEnd = ratioStart[r + 1];
+            for (int k = ratioStart[r]; k < ratioEnd; ++k) {
+                if (ratioFeed[k] != feed) {
+                    ratioFeed[kept] = ratioFeed[k] - (ratioFeed[k] > feed);
+                    ratioPart[kept] = ratioPart[k];
+                    ++kept;
+                }
+            }
+            ratioStart[r + 1] = kept;
+        }
+        ratioFeed.resize(kept);
+        ratioPart.resize(kept);
+
+        feedIds.erase(feedNames[feed]);
+        feedNames.erase(feedNames.begin() + feed);
+        cost.erase(cost.begin() + feed);
+        available.erase(available.begin() + feed);
+        for (int i = feed; i < numFeeds(); ++i) {
+            feedIds[feedNames[i]] = i;
+        }
+    }
+
+    double contentOf(int feed, int component) const {
+        int begin = contentStart[feed];
+        int end = contentStart[feed + 1];
+        int at = lower_bound(contentComponent.begin() + begin, contentComponent.begin() + end,
+                             component) - contentComponent.begin();
+        return at < end && contentComponent[at] == component ? fraction(at) : 0.0;
+    }
+
+    ProblemView view() const {
+        bool narrow = !contentFloat.empty();
+        ProblemView view{numFeeds(), numComponents(), numContent(), cost.data(), reqMin.data(),
+                         totalBlend, contentStart.data(), contentComponent.data(),
+                         narrow ? nullptr : contentFraction.data(), dropTolerance};
+        view.reqMax = reqMax.data();
+        view.available = available.data();
+        view.numRatios = numRatios();
+        view.ratioLow = ratioLow.data();
+        view.ratioHigh = ratioHigh.data();
+        view.ratioOfTotal = ratioOfTotal.data();
+        view.ratioStart = ratioStart.data();
+        view.ratioFeed = ratioFeed.data();
+        view.ratioPart = ratioPart.data();
+        view.contentFloat = narrow ? contentFloat.data() : nullptr;
+        return view;
+    }
+};
+
+// The compiled-in example problem from the DATA section.
+template <int NF, int NC>
+BlendProblem problemFromRecipe(const Recipe<NF, NC> &recipe) {
+    BlendProblem problem;
+    for (int j = 0; j < NC; ++j) {
+        problem.reqMin[problem.internComponent(recipe.components[j])] = recipe.reqMin[j];
+    }
+    for (int i = 0; i < NF; ++i) {
+        int feed = problem.internFeed(recipe.feeds[i]);
+        problem.cost[feed] = recipe.cost[i];
+        for (int j = 0; j < NC; ++j) {
+            problem.setContent(feed, j, recipe.content[i][j]);
+        }
+    }
+    problem.totalBlend = recipe.totalBlend;
+    return problem;
+}
+
+BlendProblem exampleProblem() {
+    return problemFromRecipe(EXAMPLE_RECIPE);
+}
+
+
+// --- 1c. BUILD ARENA: Reusable scratch memory for the model builder ---
+
+// A monotonic buffer: allocate() bumps a pointer, nothing is freed until
+// reset(), and all memory is owned by the arena so it is released even if CLP
+// throws half way through a build. When a build outgrows the current block a
+// new one is chained on; reset() then merges them into a single block big
+// enough for the whole build, so repeated builds of the same size make no
+// heap allocations at all. allocations() counts the arena's own heap
+// allocations (CLP's internal copies are not included).
+class BuildArena {
+public:
+    template <class T>
+    T *allocate(size_t count) {
+        const size_t alignment = alignof(max_align_t);
+        size_t bytes = (count * sizeof(T) + alignment - 1) & ~(alignment - 1);
+        if (blocks_.empty() || used_ + bytes > blocks_.back().size) {
+            size_t lastSize = blocks_.empty() ? 0 : blocks_.back().size;
+            addBlock(max(max(bytes, 2 * lastSize), MIN_BLOCK_BYTES));
+        }
+        T *memory = reinterpret_cast<T *>(blocks_.back().data.get() + used_);
+        used_ += bytes;
+        return memory;
+    }
+
+    // Releases everything allocated since the last reset.
+    void reset() {
+        if (blocks_.size() > 1) {
+            size_t total = 0;
+            for (const Block &block : blocks_) {
+                total += block.size;
+            }
+            blocks_.clear();
+            addBlock(total);
+        }
+        used_ = 0;
+    }
+
+    long allocations() const { return allocations_; }
+    size_t capacity() const {
+        size_t total = 0;
+        for (const Block &block : blocks_) {
+            total += block.size;
+        }
+        return total;
+    }
+
+private:
+    static constexpr size_t MIN_BLOCK_BYTES = 64 * 1024;
+
+    struct Block {
+        unique_ptr<unsigned char[]> data;
+        size_t size;
+    };
+
+    void addBlock(size_t size) {
+        blocks_.push_back(Block{unique_ptr<unsigned char[]>(new unsigned char[size]), size});
+        used_ = 0;
+        ++allocations_;
+    }
+
+    vector<Block> blocks_;
+    size_t used_ = 0;
+    long allocations_ = 0;
+};
+
+#endif
+
+
+// --- 1d. INSTRUMENTATION: Phase timers and solver counters ---
+
+// Phase timers read the CPU timestamp counter (steady_clock where there is
+// none) and cost a couple of atomic adds per timed block. Build with
+// -DBLENDER_INSTRUMENT=0 to compile them out entirely; the solver counters
+// are per solve rather than per iteration and stay in.
+#ifndef BLENDER_INSTRUMENT
+#define BLENDER_INSTRUMENT 1
+#endif
+
+enum Phase {
+    PHASE_LOAD,      // reading problem data
+    PHASE_BUILD,     // matrix assembly and loadProblem
+    PHASE_PRESOLVE,  // ClpPresolve before a cold solve
+    PHASE_SIMPLEX,   // primal/dual simplex, including postsolve cleanup and crossover
+    PHASE_BARRIER,   // interior point iterations (ClpInterior)
+    PHASE_PDLP,      // first-order iterations on the GPU (BLENDER_WITH_CUDA builds)
+    PHASE_BRANCH,    // CBC branch and bound of the mixed-integer blend
+    PHASE_EXTRACT,   // formatting and writing results
+    NUM_PHASES
+};
+
+const char *const PHASE_NAMES[NUM_PHASES] = {"load", "build", "presolve", "simplex", "barrier",
+                                             "pdlp", "branch", "extract"};
+
+// The algorithm of a cold solve (see chooseAlgorithm())
+enum Algorithm {
+    ALGORITHM_AUTO,
+    ALGORITHM_DUAL,
+    ALGORITHM_PRIMAL,
+    ALGORITHM_BARRIER,  // ClpInterior, then a primal crossover
+    ALGORITHM_PDLP,     // PDHG on the GPU, then a primal crossover (BLENDER_WITH_CUDA builds)
+    NUM_ALGORITHMS
+};
+
+const char *const ALGORITHM_NAMES[NUM_ALGORITHMS] = {"auto", "dual", "primal", "barrier", "pdlp"};
+
+// What runSimplex() tries, in this order, when the stall monitor stops a solve
+enum StallRemedy {
+    REMEDY_PERTURB,  // perturb the problem now
+    REMEDY_PRICING,  // dual: full steepest edge; primal: Devex
+    REMEDY_SCALING,  // geometric scaling (equilibrium if it was geometric)
+    NUM_STALL_REMEDIES
+};
+
+const char *const STALL_REMEDY_NAMES[NUM_STALL_REMEDIES] = {"perturb", "pricing", "scaling"};
+
+// Racing solve entrants, in the order they join the race (see raceSolve())
+struct RaceVariant {
+    const char *name;
+    Algorithm algorithm;
+    int scaling;  // ClpModel::scaling() mode, -1 = as built
+};
+
+const RaceVariant RACE_VARIANTS[] = {
+    {"dual", ALGORITHM_DUAL, -1},
+    {"primal", ALGORITHM_PRIMAL, -1},
+    {"barrier", ALGORITHM_BARRIER, -1},
+    {"dual-geometric", ALGORITHM_DUAL, 2},
+    {"primal-unscaled", ALGORITHM_PRIMAL, 0},
+    {"dual-unscaled", ALGORITHM_DUAL, 0},
+};
+const int NUM_RACE_VARIANTS = sizeof(RACE_VARIANTS) / sizeof(RACE_VARIANTS[0]);
+
+inline uint64_t readTicks() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return chrono::steady_clock::now().time_since_epoch().count();
+#endif
+}
+
+// Upper bounds of the server latency histogram buckets; the last is +Inf
+const double LATENCY_BUCKET_SECONDS[] = {0.00025, 0.0005, 0.001, 0.002, 0.005, 0.01, 0.05};
+const int NUM_LATENCY_BUCKETS = sizeof(LATENCY_BUCKET_SECONDS) / sizeof(double) + 1;
+
+// Process-wide counters, updated from any thread. The tick rate is calibrated
+// against steady_clock over the life of the process when stats are written.
+struct SolverStats {
+    atomic<uint64_t> phaseTicks[NUM_PHASES] = {};
+    atomic<uint64_t> phaseCalls[NUM_PHASES] = {};
+
+    atomic<uint64_t> solves{0};
+    atomic<uint64_t> nonOptimalSolves{0};
+    atomic<uint64_t> iterations{0};
+    atomic<uint64_t> factorizations{0};
+    atomic<uint64_t> presolveRowsRemoved{0};
+    atomic<uint64_t> presolveColumnsRemoved{0};
+    atomic<uint64_t> presolveCacheHits{0};       // scenarios solved on the cached reduced model
+    atomic<uint64_t> presolveCacheFallbacks{0};  // scenarios that needed a full presolve
+    atomic<uint64_t> presolveCacheCleanups{0};   // cached solves finished by a primal pass
+    atomic<uint64_t> presolveCacheRebuilds{0};   // presolves redone for an uncovered scenario
+    atomic<uint64_t> presolveCacheMismatches{0}; // checked cached solves a fresh solve disagreed with
+    atomic<uint64_t> smallKernelSolves{0};       // scenarios solved by SmallBlendKernel
+    atomic<uint64_t> smallKernelFallbacks{0};    // scenarios it handed to ClpSimplex
+    atomic<uint64_t> resultCacheHits{0};         // solves answered from SolveCache
+    atomic<uint64_t> resultCacheMisses{0};
+    atomic<uint64_t> resultCacheWarmStarts{0};   // misses started from a cached basis
+    atomic<uint64_t> resultCacheEvictions{0};
+    atomic<uint64_t> resultCacheEntries{0};      // gauges, updated on insertion
+    atomic<uint64_t> resultCacheBytes{0};
+    atomic<uint64_t> basisStoreHits{0};          // solves started from a stored basis
+    atomic<uint64_t> mipNodes{0};                // branch-and-bound nodes
+
+    // Server: requests answered, batches dispatched and request latency
+    atomic<uint64_t> serverRequests{0};
+    atomic<uint64_t> serverBatches{0};
+    atomic<uint64_t> serverLatencyNanos{0};
+    atomic<uint64_t> serverLatencyBuckets[NUM_LATENCY_BUCKETS] = {};
+
+    // State at the exit of the most recent solve
+    atomic<double> lastPrimalInfeasibility{0.0};
+    atomic<double> lastDualInfeasibility{0.0};
+    atomic<int> lastNumPrimalInfeasibilities{0};
+    atomic<int> lastNumDualInfeasibilities{0};
+    atomic<double> lastMipGap{0.0};              // relative gap of the last branch and bound
+
+    // Cold-solve algorithms, [algorithm][0: set by the user, 1: picked by auto]
+    atomic<uint64_t> algorithmChoices[NUM_ALGORITHMS][2] = {};
+    atomic<int> lastAlgorithm{ALGORITHM_AUTO};
+    atomic<uint64_t> raceWins[NUM_RACE_VARIANTS] = {};
+
+    // Stalled simplex solves: remedies applied, the solves each one got
+    // going again, and stalls that outlasted all of them
+    atomic<uint64_t> stallRemedies[NUM_STALL_REMEDIES] = {};
+    atomic<uint64_t> stallRemedySuccesses[NUM_STALL_REMEDIES] = {};
+    atomic<uint64_t> stallsUnresolved{0};
+
+    // Set by startClock(), first thing in main(); the global itself is
+    // constant-initialized
+    uint64_t startTicks = 0;
+    chrono::steady_clock::time_point startTime;
+
+    void startClock() {
+        startTicks = readTicks();
+        startTime = chrono::steady_clock::now();
+    }
+};
+
+SolverStats solverStats;
+
+// Adds the lifetime of the object to one phase.
+class PhaseTimer {
+public:
+    explicit PhaseTimer(Phase phase) : phase_(phase), start_(readTicks()) {}
+    PhaseTimer(const PhaseTimer &) = delete;
+    PhaseTimer &operator=(const PhaseTimer &) = delete;
+    ~PhaseTimer() {
+        solverStats.phaseTicks[phase_].fetch_add(readTicks() - start_, memory_order_relaxed);
+        solverStats.phaseCalls[phase_].fetch_add(1, memory_order_relaxed);
+    }
+
+private:
+    Phase phase_;
+    uint64_t start_;
+};
+
+#if BLENDER_INSTRUMENT
+#define BLENDER_TIME_PHASE(phase) PhaseTimer phaseTimer(phase)
+#else
+#define BLENDER_TIME_PHASE(phase) ((void)0)
+#endif
+
+// Counts factorizations from inside CLP; it is attached to every model the
+// builder creates (CLP keeps its own clone of it). While watch()ed it is
+// also the stall monitor: a solve that goes `window` iterations in a row
+// without moving the objective or the sum of infeasibilities (relative to
+// STALL_TOLERANCE) is stopped, for runSimplex() to apply a remedy.
+const double STALL_TOLERANCE = 1.0e-9;
+
+class CountingEventHandler : public ClpEventHandler {
+public:
+    int event(Event whichEvent) override {
+        if (whichEvent == endOfFactorization) {
+            solverStats.factorizations.fetch_add(1, memory_order_relaxed);
+        }
+        if (whichEvent == endOfIteration && window_ > 0 && model_) {
+            double objective = model_->objectiveValue();
+            double infeasibility =
+                model_->sumPrimalInfeasibilities() + model_->sumDualInfeasibilities();
+            if (moved(objective, objective_) || moved(infeasibility, infeasibility_)) {
+                objective_ = objective;
+                infeasibility_ = infeasibility;
+                flat_ = 0;
+            } else if (++flat_ >= window_) {
+                stalled_ = true;
+                return 5; // stop: status 5, "stopped by event handler"
+            }
+        }
+        return -1; // carry on
+    }
+    ClpEventHandler *clone() const override { return new CountingEventHandler(*this); }
+
+    // Starts watching the next solve; window 0 never stops it
+    void watch(int window) {
+        window_ = window;
+        flat_ = 0;
+        stalled_ = false;
+        objective_ = infeasibility_ = NAN;
+    }
+    bool stalled() const { return stalled_; }
+
+private:
+    // NaN (nothing seen yet) always counts as a move
+    static bool moved(double value, double reference) {
+        return !(fabs(value - reference) <= STALL_TOLERANCE * (1.0 + fabs(reference)));
+    }
+
+    int window_ = 0;
+    int flat_ = 0;
+    bool stalled_ = false;
+    double objective_ = NAN;
+    double infeasibility_ = NAN;
+};
+
+// Records the outcome of a finished solve.
+void recordSolve(const ClpSimplex &model) {
+    solverStats.solves.fetch_add(1, memory_order_relaxed);
+    solverStats.iterations.fetch_add(model.numberIterations(), memory_order_relaxed);
+    if (!model.isProvenOptimal()) {
+        solverStats.nonOptimalSolves.fetch_add(1, memory_order_relaxed);
+    }
+    solverStats.lastPrimalInfeasibility.store(model.sumPrimalInfeasibilities(), memory_order_relaxed);
+    solverStats.lastDualInfeasibility.store(model.sumDualInfeasibilities(), memory_order_relaxed);
+    solverStats.lastNumPrimalInfeasibilities.store(model.numberPrimalInfeasibilities(),
+                                                   memory_order_relaxed);
+    solverStats.lastNumDualInfeasibilities.store(model.numberDualInfeasibilities(),
+                                                 memory_order_relaxed);
+}
+
+// Peak resident set size of the process, 0 if it cannot be read
+uint64_t peakRssBytes() {
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return 0;
+    }
+#ifdef __APPLE__
+    return usage.ru_maxrss;  // bytes
+#else
+    return static_cast<uint64_t>(usage.ru_maxrss) * 1024;  // kilobytes
+#endif
+}
+
+#if !BLENDER_EMBEDDED  // the stats file and section 1e
+
+// Writes the counters in the Prometheus text exposition format. The file is
+// replaced atomically, so a node_exporter textfile collector (or anything
+// else polling it) never sees a partial file.
+bool writeStatsFile(const char *path, string &error) {
+    double elapsed = chrono::duration<double>(chrono::steady_clock::now() - solverStats.startTime).count();
+    uint64_t ticks = readTicks() - solverStats.startTicks;
+    double secondsPerTick = ticks > 0 ? elapsed / ticks : 0.0;
+
+    ostringstream out;
+    out.precision(17);
+    out << "# HELP blender_phase_seconds_total Time spent in each pipeline phase.\n"
+        << "# TYPE blender_phase_seconds_total counter\n";
+    for (int phase = 0; phase < NUM_PHASES; ++phase) {
+        out << "blender_phase_seconds_total{phase=\"" << PHASE_NAMES[phase] << "\"} "
+            << solverStats.phaseTicks[phase].load() * secondsPerTick << "\n";
+    }
+    out << "# HELP blender_phase_calls_total Number of timed blocks per phase.\n"
+        << "# TYPE blender_phase_calls_total counter\n";
+    for (int phase = 0; phase < NUM_PHASES; ++phase) {
+        out << "blender_phase_calls_total{phase=\"" << PHASE_NAMES[phase] << "\"} "
+            << solverStats.phaseCalls[phase].load() << "\n";
+    }
+
+    auto counter = [&](const char *name, const char *help, uint64_t value) {
+        out << "# HELP " << name << " " << help << "\n# TYPE " << name << " counter\n"
+            << name << " " << value << "\n";
+    };
+    auto gauge = [&](const char *name, const char *help, double value) {
+        out << "# HELP " << name << " " << help << "\n# TYPE " << name << " gauge\n"
+            << name << " " << value << "\n";
+    };
+    counter("blender_solves_total", "Completed simplex solves.", solverStats.solves.load());
+    counter("blender_nonoptimal_solves_total", "Solves that did not prove optimality.",
+            solverStats.nonOptimalSolves.load());
+    counter("blender_simplex_iterations_total", "Simplex iterations.", solverStats.iterations.load());
+    counter("blender_factorizations_total", "Basis factorizations.",
+            solverStats.factorizations.load());
+    counter("blender_presolve_rows_removed_total", "Rows removed by presolve.",
+            solverStats.presolveRowsRemoved.load());
+    counter("blender_presolve_columns_removed_total", "Columns removed by presolve.",
+            solverStats.presolveColumnsRemoved.load());
+    counter("blender_presolve_cache_hits_total", "Scenarios solved on the cached presolved model.",
+            solverStats.presolveCacheHits.load());
+    counter("blender_presolve_cache_fallbacks_total", "Scenarios that needed a full presolve.",
+            solverStats.presolveCacheFallbacks.load());
+    counter("blender_presolve_cache_cleanups_total",
+            "Cached solves finished by a primal pass on the original model.",
+            solverStats.presolveCacheCleanups.load());
+    counter("blender_presolve_cache_rebuilds_total",
+            "Presolves redone for a scenario the cached one did not cover.",
+            solverStats.presolveCacheRebuilds.load());
+    counter("blender_presolve_cache_mismatches_total",
+            "Checked cached solves that disagreed with a fresh solve.",
+            solverStats.presolveCacheMismatches.load());
+    counter("blender_small_kernel_solves_total", "Scenarios solved by the small-LP kernel.",
+            solverStats.smallKernelSolves.load());
+    counter("blender_small_kernel_fallbacks_total",
+            "Scenarios the small-LP kernel handed to ClpSimplex.",
+            solverStats.smallKernelFallbacks.load());
+    counter("blender_result_cache_hits_total", "Solves answered from the result cache.",
+            solverStats.resultCacheHits.load());
+    counter("blender_result_cache_misses_total", "Result cache lookups that missed.",
+            solverStats.resultCacheMisses.load());
+    counter("blender_result_cache_warm_starts_total", "Misses warm-started from a cached basis.",
+            solverStats.resultCacheWarmStarts.load());
+    counter("blender_result_cache_evictions_total", "Entries evicted from the result cache.",
+            solverStats.resultCacheEvictions.load());
+    counter("blender_basis_store_hits_total", "Solves started from a stored basis.",
+            solverStats.basisStoreHits.load());
+    counter("blender_mip_nodes_total", "Branch-and-bound nodes.", solverStats.mipNodes.load());
+    gauge("blender_last_mip_gap", "Relative gap at the end of the last branch and bound.",
+          solverStats.lastMipGap.load());
+    gauge("blender_result_cache_entries", "Entries in the result cache.",
+          solverStats.resultCacheEntries.load());
+    gauge("blender_result_cache_bytes", "Memory held by the result cache.",
+          solverStats.resultCacheBytes.load());
+    gauge("blender_peak_rss_bytes", "Peak resident set size of the process.", peakRssBytes());
+    gauge("blender_last_primal_infeasibility", "Sum of primal infeasibilities at the last exit.",
+          solverStats.lastPrimalInfeasibility.load());
+    gauge("blender_last_dual_infeasibility", "Sum of dual infeasibilities at the last exit.",
+          solverStats.lastDualInfeasibility.load());
+    gauge("blender_last_primal_infeasibilities", "Number of primal infeasibilities at the last exit.",
+          solverStats.lastNumPrimalInfeasibilities.load());
+    gauge("blender_last_dual_infeasibilities", "Number of dual infeasibilities at the last exit.",
+          solverStats.lastNumDualInfeasibilities.load());
+    out << "# HELP blender_algorithm_choices_total Cold solves per algorithm and who chose it.\n"
+        << "# TYPE blender_algorithm_choices_total counter\n";
+    for (int algorithm = ALGORITHM_DUAL; algorithm < NUM_ALGORITHMS; ++algorithm) {
+        for (int automatic = 0; automatic < 2; ++automatic) {
+            out << "blender_algorithm_choices_total{algorithm=\"" << ALGORITHM_NAMES[algorithm]
+                << "\",chosen_by=\"" << (automatic ? "auto" : "user") << "\"} "
+                << solverStats.algorithmChoices[algorithm][automatic].load() << "\n";
+        }
+    }
+    out << "# HELP blender_race_wins_total Racing solves won per entrant.\n"
+        << "# TYPE blender_race_wins_total counter\n";
+    for (int v = 0; v < NUM_RACE_VARIANTS; ++v) {
+        out << "blender_race_wins_total{variant=\"" << RACE_VARIANTS[v].name << "\"} "
+            << solverStats.raceWins[v].load() << "\n";
+    }
+    out << "# HELP blender_stall_remedies_total Stall remedies applied to stopped simplex solves.\n"
+        << "# TYPE blender_stall_remedies_total counter\n";
+    for (int remedy = 0; remedy < NUM_STALL_REMEDIES; ++remedy) {
+        out << "blender_stall_remedies_total{remedy=\"" << STALL_REMEDY_NAMES[remedy] << "\"} "
+            << solverStats.stallRemedies[remedy].load() << "\n";
+    }
+    out << "# HELP blender_stall_remedy_successes_total Stalled solves a remedy got to finish.\n"
+        << "# TYPE blender_stall_remedy_successes_total counter\n";
+    for (int remedy = 0; remedy < NUM_STALL_REMEDIES; ++remedy) {
+        out << "blender_stall_remedy_successes_total{remedy=\"" << STALL_REMEDY_NAMES[remedy]
+            << "\"} " << solverStats.stallRemedySuccesses[remedy].load() << "\n";
+    }
+    counter("blender_stalls_unresolved_total", "Stalls that outlasted every remedy.",
+            solverStats.stallsUnresolved.load());
+    counter("blender_server_batches_total", "Micro-batches dispatched by the server.",
+            solverStats.serverBatches.load());
+
+    out << "# HELP blender_request_latency_seconds Server request latency, receipt to response.\n"
+        << "# TYPE blender_request_latency_seconds histogram\n";
+    uint64_t cumulative = 0;
+    for (int bucket = 0; bucket < NUM_LATENCY_BUCKETS; ++bucket) {
+        cumulative += solverStats.serverLatencyBuckets[bucket].load();
+        out << "blender_request_latency_seconds_bucket{le=\"";
+        if (bucket < NUM_LATENCY_BUCKETS - 1) {
+            char bound[32];
+            out.write(bound, to_chars(bound, bound + sizeof(bound), LATENCY_BUCKET_SECONDS[bucket],
+                                       chars_format::fixed).ptr - bound);
+        } else {
+            out << "+Inf";
+        }
+        out << "\"} " << cumulative << "\n";
+    }
+    out << "blender_request_latency_seconds_sum " << solverStats.serverLatencyNanos.load() * 1.0e-9
+        << "\nblender_request_latency_seconds_count " << solverStats.serverRequests.load() << "\n";
+
+    string temporary = string(path) + ".tmp";
+    {
+        ofstream file(temporary);
+        file << out.str();
+        if (!file.flush()) {
+            error = "cannot write " + temporary;
+            return false;
+        }
+    }
+    if (rename(temporary.c_str(), path) != 0) {
+        error = string("cannot replace ") + path + ": " + strerror(errno);
+        return false;
+    }
+    return true;
+}
+
+
+// Writes the stats file (if one was asked for) when it goes out of scope,
+// i.e. on every way out of main.
+class StatsFileWriter {
+public:
+    explicit StatsFileWriter(const char *path) : path_(path) {}
+    StatsFileWriter(const StatsFileWriter &) = delete;
+    StatsFileWriter &operator=(const StatsFileWriter &) = delete;
+    ~StatsFileWriter() {
+        string error;
+        if (path_ && !writeStatsFile(path_, error)) {
+            cerr << "Cannot write stats: " << error << endl;
+        }
+    }
+
+private:
+    const char *path_;
+};
+
+
+// --- 1e. DATA FILES: Streaming CSV and memory-mapped binary problem files ---
+
+// CSV layout (one feed per row, one component per column; empty cells are 0):
+//   feed,cost,X,Y          header: component names from the third column on
+//   A,10.0,0.60,0.10       feed name, $/unit, content fractions
+//   @min,,0.40,0.30        minimum required fractions
+//   @max,,,0.45            maximum fractions (empty: no maximum)
+//   @total,100             total blend quantity
+//   @ratio,A+B,C,0.5,2     ratio limit 0.5 <= (x_A + x_B) / x_C <= 2; a '*'
+//                          denominator is the whole blend, empty bounds none
+// A header column named @available holds each feed's availability in units
+// (empty: unlimited) instead of a component.
+// The file is read in fixed-size chunks with read(2) and parsed in place, so
+// memory use does not depend on the file size and numeric fields never become
+// strings. Only feed and component names are copied (once, when interned).
+const size_t CSV_CHUNK_BYTES = 1 << 20;
+const int AVAILABLE_COLUMN = -2;  // componentOfColumn entry of the @available column
+
+// Parses a decimal number ([+-]digits[.digits][(e|E)[+-]digits]). Values with
+// at most 19 significant digits and a small decimal exponent are converted
+// exactly with one multiply or divide by a power of ten (both operands are
+// exact doubles, so IEEE rounding gives the correctly rounded result); the
+// rare remaining inputs go through strtod. Fields longer than
+// MAX_NUMBER_CHARS are rejected rather than truncated for strtod.
+const size_t MAX_NUMBER_CHARS = 127;
+
+bool parseNumber(const char *begin, const char *end, double &value) {
+    static const double POWERS_OF_TEN[] = {1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,
+                                           1e8,  1e9,  1e10, 1e11, 1e12, 1e13, 1e14, 1e15,
+                                           1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+    const char *p = begin;
+    bool negative = false;
+    if (p < end && (*p == '+' || *p == '-')) {
+        negative = *p++ == '-';
+    }
+
+    uint64_t mantissa = 0;
+    int digits = 0;      // significant digits kept in mantissa
+    int exponent = 0;    // decimal exponent applied to mantissa
+    bool anyDigit = false;
+    bool exact = true;
+    for (; p < end && *p >= '0' && *p <= '9'; ++p) {
+        anyDigit = true;
+        if (digits < 19) {
+            mantissa = mantissa * 10 + (*p - '0');
+            digits += mantissa != 0;
+        } else {
+            ++exponent;
+            exact = false;
+        }
+    }
+    if (p < end && *p == '.') {
+        for (++p; p < end && *p >= '0' && *p <= '9'; ++p) {
+            anyDigit = true;
+            if (digits < 19) {
+                mantissa = mantissa * 10 + (*p - '0');
+                digits += mantissa != 0;
+                --exponent;
+            } else {
+                exact = false;
+            }
+        }
+    }
+    if (!anyDigit) {
+        return false;
+    }
+    if (p < end && (*p == 'e' || *p == 'E')) {
+        ++p;
+        bool negativeExponent = false;
+        if (p < end && (*p == '+' || *p == '-')) {
+            negativeExponent = *p++ == '-';
+        }
+        if (p == end || *p < '0' || *p > '9') {
+            return false;
+        }
+        int written = 0;
+        for (; p < end && *p >= '0' && *p <= '9'; ++p) {
+            written = min(written * 10 + (*p - '0'), 100000);
+        }
+        exponent += negativeExponent ? -written : written;
+    }
+    if (p != end) {
+        return false;
+    }
+
+    if (exact && mantissa < (uint64_t(1) << 53) && exponent >= -22 && exponent <= 22) {
+        value = static_cast<double>(mantissa);
+        value = exponent < 0 ? value / POWERS_OF_TEN[-exponent] : value * POWERS_OF_TEN[exponent];
+    } else {
+        size_t length = end - begin;
+        if (length > MAX_NUMBER_CHARS) {
+            return false;
+        }
+        char text[MAX_NUMBER_CHARS + 1];
+        memcpy(text, begin, length);
+        text[length] = '\0';
+        value = strtod(text, nullptr);
+        negative = false; // strtod saw the sign
+    }
+    if (negative) {
+        value = -value;
+    }
+    return true;
+}
+
+// Splits one CSV line (no line terminator) into [begin, end) field pointers,
+// trimming blanks around each field.
+void splitCsvLine(const char *begin, const char *end, vector<pair<const char *, const char *>> &fields) {
+    fields.clear();
+    for (;;) {
+        const char *stop = static_cast<const char *>(memchr(begin, ',', end - begin));
+        const char *fieldEnd = stop ? stop : end;
+        const char *first = begin;
+        const char *last = fieldEnd;
+        while (first < last && (*first == ' ' || *first == '\t')) {
+            ++first;
+        }
+        while (last > first && (last[-1] == ' ' || last[-1] == '\t' || last[-1] == '\r')) {
+            --last;
+        }
+        fields.emplace_back(first, last);
+        if (!stop) {
+            return;
+        }
+        begin = stop + 1;
+    }
+}
+
+// Parses one CSV line into the problem; `componentOfColumn` maps CSV column
+// k + 1 to its component ID (or AVAILABLE_COLUMN) and is filled from the
+// header.
+bool loadCsvLine(const char *begin, const char *end, long lineNumber, BlendProblem &problem,
+                 vector<int> &componentOfColumn, vector<pair<const char *, const char *>> &fields,
+                 string &error) {
+    splitCsvLine(begin, end, fields);
+    if (fields.size() == 1 && fields[0].first == fields[0].second) {
+        return true; // blank line
+    }
+
+    auto fail = [&](const char *what) {
+        error = "line " + to_string(lineNumber) + ": " + what;
+        return false;
+    };
+    auto number = [&](size_t field, double &value) {
+        if (field >= fields.size() || fields[field].first == fields[field].second) {
+            value = 0.0;
+            return true;
+        }
+        return parseNumber(fields[field].first, fields[field].second, value);
+    };
+    auto isTag = [&](const char *tag) {
+        size_t length = strlen(tag);
+        return static_cast<size_t>(fields[0].second - fields[0].first) == length &&
+               memcmp(fields[0].first, tag, length) == 0;
+    };
+
+    // Header: every column after feed and cost is a component
+    if (componentOfColumn.empty()) {
+        if (fields.size() < 2) {
+            return fail("header needs at least the feed and cost columns");
+        }
+        componentOfColumn.push_back(-1); // placeholder: header seen
+        for (size_t k = 2; k < fields.size(); ++k) {
+            string name(fields[k].first, fields[k].second);
+            componentOfColumn.push_back(name == "@available" ? AVAILABLE_COLUMN
+                                                             : problem.internComponent(name));
+        }
+        return true;
+    }
+
+    // Empty cells of limits are "no limit" rather than 0
+    auto limit = [&](size_t field, double &value) {
+        if (field >= fields.size() || fields[field].first == fields[field].second) {
+            value = 1.0e+20;
+            return true;
+        }
+        return parseNumber(fields[field].first, fields[field].second, value);
+    };
+
+    double value;
+    if (isTag("@ratio")) {
+        if (fields.size() != 5) {
+            return fail("@ratio needs numerator, denominator, low and high");
+        }
+        vector<int> sides[2];
+        bool ofTotal = false;
+        for (int side = 0; side < 2; ++side) {
+            const char *at = fields[side + 1].first;
+            const char *sideEnd = fields[side + 1].second;
+            if (side == 1 && sideEnd - at == 1 && *at == '*') {
+                ofTotal = true;
+                break;
+            }
+            while (at <= sideEnd) {
+                const char *plus = static_cast<const char *>(memchr(at, '+', sideEnd - at));
+                const char *nameEnd = plus ? plus : sideEnd;
+                auto found = problem.feedIds.find(string(at, nameEnd));
+                if (found == problem.feedIds.end()) {
+                    return fail("unknown feed in @ratio");
+                }
+                sides[side].push_back(found->second);
+                at = nameEnd + 1;
+            }
+        }
+        double low, high;
+        if (!number(3, low) || !limit(4, high)) {
+            return fail("bad ratio bound");
+        }
+        problem.addRatio(sides[0], sides[1], ofTotal, low, high);
+        return true;
+    }
+
+    if (fields.size() > componentOfColumn.size() + 1) {
+        return fail("more columns than the header");
+    }
+
+    if (isTag("@total")) {
+        if (!number(1, problem.totalBlend)) {
+            return fail("bad total");
+        }
+    } else if (isTag("@min") || isTag("@max")) {
+        bool maximum = isTag("@max");
+        for (size_t k = 2; k < fields.size(); ++k) {
+            int component = componentOfColumn[k - 1];
+            if (component == AVAILABLE_COLUMN) {
+                continue;
+            }
+            if (!(maximum ? limit(k, value) : number(k, value))) {
+                return fail(maximum ? "bad maximum spec" : "bad minimum spec");
+            }
+            (maximum ? problem.reqMax : problem.reqMin)[component] = value;
+        }
+    } else {
+        if (fields[0].first == fields[0].second) {
+            return fail("missing feed name");
+        }
+        int feed = problem.internFeed(string(fields[0].first, fields[0].second));
+        if (!number(1, problem.cost[feed])) {
+            return fail("bad cost");
+        }
+        for (size_t k = 2; k < componentOfColumn.size() + 1; ++k) {
+            if (componentOfColumn[k - 1] == AVAILABLE_COLUMN) {
+                if (!limit(k, problem.available[feed])) {
+                    return fail("bad availability");
+                }
+            } else if (k < fields.size()) {
+                if (!number(k, value)) {
+                    return fail("bad content fraction");
+                }
+                problem.setContent(feed, componentOfColumn[k - 1], value);
+            }
+        }
+    }
+    return true;
+}
+
+// Streams a CSV problem file into `problem` (which should be empty).
+bool loadCsvProblem(const char *path, BlendProblem &problem, string &error) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        error = string("cannot open ") + path + ": " + strerror(errno);
+        return false;
+    }
+
+    vector<char> buffer(CSV_CHUNK_BYTES);
+    vector<int> componentOfColumn;
+    vector<pair<const char *, const char *>> fields;
+    size_t carried = 0;  // bytes of an unfinished line at the front of buffer
+    long lineNumber = 0;
+    bool ok = true;
+
+    for (;;) {
+        if (carried == buffer.size()) {
+            buffer.resize(2 * buffer.size()); // a line longer than the chunk
+        }
+        ssize_t got = read(fd, buffer.data() + carried, buffer.size() - carried);
+        if (got < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            error = string("read failed: ") + strerror(errno);
+            ok = false;
+            break;
+        }
+
+        const char *data = buffer.data();
+        const char *stop = data + carried + got;
+        const char *line = data;
+        for (;;) {
+            const char *newline = static_cast<const char *>(memchr(line, '\n', stop - line));
+            if (!newline) {
+                break;
+            }
+            ok = loadCsvLine(line, newline, ++lineNumber, problem, componentOfColumn, fields, error);
+            if (!ok) {
+                break;
+            }
+            line = newline + 1;
+        }
+        if (!ok) {
+            break;
+        }
+
+        carried = stop - line;
+        if (got == 0) {
+            // End of file: whatever is left is the last, unterminated line
+            if (carried > 0) {
+                ok = loadCsvLine(line, stop, ++lineNumber, problem, componentOfColumn, fields, error);
+            }
+            break;
+        }
+        memmove(buffer.data(), line, carried);
+    }
+    close(fd);
+
+    if (ok && componentOfColumn.empty()) {
+        error = "no header";
+        ok = false;
+    }
+    return ok;
+}
+
+// Writes a problem in the CSV layout loadCsvProblem reads (shortest
+// round-trip numbers, structural zeros left empty).
+bool writeCsvProblem(const char *path, const BlendProblem &problem, string &error) {
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        error = string("cannot create ") + path + ": " + strerror(errno);
+        return false;
+    }
+
+    string text;
+    bool ok = true;
+    auto number = [&](double value) {
+        char digits[32];
+        text.append(digits, to_chars(digits, digits + sizeof(digits), value).ptr);
+    };
+    auto flush = [&](size_t atLeast) {
+        if (text.size() < atLeast) {
+            return;
+        }
+        size_t written = 0;
+        while (ok && written < text.size()) {
+            ssize_t put = write(fd, text.data() + written, text.size() - written);
+            if (put < 0 && errno == EINTR) {
+                continue;
+            }
+            ok = put > 0;
+            written += ok ? put : 0;
+        }
+        text.clear();
+    };
+
+    auto limited = [](double value) { return value < 1.0e+20; };
+    auto limit = [&](double value) {
+        if (limited(value)) {
+            number(value);
+        }
+    };
+    bool availability = any_of(problem.available.begin(), problem.available.end(), limited);
+
+    text.append("feed,cost");
+    for (const string &name : problem.componentNames) {
+        text.append(",").append(name);
+    }
+    text.append(availability ? ",@available\n" : "\n");
+    for (int i = 0; i < problem.numFeeds(); ++i) {
+        text.append(problem.feedNames[i]).append(",");
+        number(problem.cost[i]);
+        int k = problem.contentStart[i];
+        for (int j = 0; j < problem.numComponents(); ++j) {
+            text.append(",");
+            if (k < problem.contentStart[i + 1] && problem.contentComponent[k] == j) {
+                number(problem.fraction(k++));
+            }
+        }
+        if (availability) {
+            text.append(",");
+            limit(problem.available[i]);
+        }
+        text.append("\n");
+        flush(CSV_CHUNK_BYTES);
+    }
+    text.append("@min,");
+    for (double fraction : problem.reqMin) {
+        text.append(",");
+        number(fraction);
+    }
+    if (any_of(problem.reqMax.begin(), problem.reqMax.end(), limited)) {
+        text.append("\n@max,");
+        for (double fraction : problem.reqMax) {
+            text.append(",");
+            limit(fraction);
+        }
+    }
+    text.append("\n@total,");
+    number(problem.totalBlend);
+    text.append("\n");
+    for (int r = 0; r < problem.numRatios(); ++r) {
+        string sides[2];
+        for (int k = problem.ratioStart[r]; k < problem.ratioStart[r + 1]; ++k) {
+            for (int side = 0; side < 2; ++side) {
+                if (problem.ratioPart[k] & (side ? RATIO_DENOMINATOR : RATIO_NUMERATOR)) {
+                    sides[side].append(sides[side].empty() ? "" : "+")
+                        .append(problem.feedNames[problem.ratioFeed[k]]);
+                }
+            }
+        }
+        text.append("@ratio,").append(sides[0]).append(",");
+        text.append(problem.ratioOfTotal[r] ? "*" : sides[1]).append(",");
+        if (problem.ratioLow[r] > 0.0) {
+            number(problem.ratioLow[r]);
+        }
+        text.append(",");
+        limit(problem.ratioHigh[r]);
+        text.append("\n");
+    }
+    flush(0);
+
+    if (!ok) {
+        error = string("write failed: ") + strerror(errno);
+    }
+    close(fd);
+    return ok;
+}
+
+// Binary columnar layout: a header followed by 8-byte aligned arrays in the
+// BlendProblem layout, in native byte order, then the NUL-terminated feed and
+// component names. The arrays can be used in place through a MappedProblem.
+// Problems with limits are written as version 2, which puts a BinaryLimits
+// block right after the header; version 1 files have none.
+const char BINARY_MAGIC[8] = {'B', 'L', 'N', 'D', 'C', 'O', 'L', '1'};
+const char BINARY_MAGIC_LIMITS[8] = {'B', 'L', 'N', 'D', 'C', 'O', 'L', '2'};
+
+struct BinaryHeader {
+    char magic[8];
+    uint32_t numFeeds;
+    uint32_t numComponents;
+    uint64_t numContent;
+    double totalBlend;
+    // Byte offsets from the start of the file
+    uint64_t costOffset;              // double[numFeeds]
+    uint64_t reqMinOffset;            // double[numComponents]
+    uint64_t contentStartOffset;      // int32[numFeeds + 1]
+    uint64_t contentComponentOffset;  // int32[numContent]
+    uint64_t contentFractionOffset;   // double[numContent]
+    uint64_t namesOffset;             // feed names, then component names
+    uint64_t namesBytes;
+};
+
+struct BinaryLimits {
+    uint64_t numRatios;
+    uint64_t numRatioEntries;
+    // Byte offsets from the start of the file
+    uint64_t reqMaxOffset;        // double[numComponents]
+    uint64_t availableOffset;     // double[numFeeds]
+    uint64_t ratioLowOffset;      // double[numRatios]
+    uint64_t ratioHighOffset;     // double[numRatios]
+    uint64_t ratioOfTotalOffset;  // int32[numRatios]
+    uint64_t ratioStartOffset;    // int32[numRatios + 1]
+    uint64_t ratioFeedOffset;     // int32[numRatioEntries]
+    uint64_t ratioPartOffset;     // int32[numRatioEntries]
+};
+
+// Writes `size` bytes to a new (or truncated) file, retrying short writes.
+bool writeWholeFile(const char *path, const void *data, size_t size, string &error) {
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        error = string("cannot create ") + path + ": " + strerror(errno);
+        return false;
+    }
+    size_t written = 0;
+    while (written < size) {
+        ssize_t put = write(fd, static_cast<const char *>(data) + written, size - written);
+        if (put < 0 && errno == EINTR) {
+            continue;
+        }
+        if (put < 0) {
+            error = string("write failed: ") + strerror(errno);
+            close(fd);
+            return false;
+        }
+        written += put;
+    }
+    close(fd);
+    return true;
+}
+
+// Reads a whole file into `contents`.
+bool readWholeFile(const char *path, vector<char> &contents, string &error) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        error = string("cannot open ") + path + ": " + strerror(errno);
+        return false;
+    }
+    contents.clear();
+    char buffer[64 * 1024];
+    for (;;) {
+        ssize_t got = read(fd, buffer, sizeof(buffer));
+        if (got < 0 && errno == EINTR) {
+            continue;
+        }
+        if (got < 0) {
+            error = string("read failed: ") + strerror(errno);
+            close(fd);
+            return false;
+        }
+        if (got == 0) {
+            break;
+        }
+        contents.insert(contents.end(), buffer, buffer + got);
+    }
+    close(fd);
+    return true;
+}
+
+// Lays `problem` out in the binary file format (see BinaryHeader).
+void binaryProblemImage(const BlendProblem &problem, vector<char> &image) {
+    auto align = [](uint64_t offset) { return (offset + 7) & ~uint64_t(7); };
+
+    bool withLimits = problem.hasLimits();
+    BinaryHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, withLimits ? BINARY_MAGIC_LIMITS : BINARY_MAGIC, sizeof(header.magic));
+    header.numFeeds = problem.numFeeds();
+    header.numComponents = problem.numComponents();
+    header.numContent = problem.numContent();
+    header.totalBlend = problem.totalBlend;
+    header.costOffset = align(sizeof(header) + (withLimits ? sizeof(BinaryLimits) : 0));
+    header.reqMinOffset = align(header.costOffset + sizeof(double) * header.numFeeds);
+    header.contentStartOffset = align(header.reqMinOffset + sizeof(double) * header.numComponents);
+    header.contentComponentOffset =
+        align(header.contentStartOffset + sizeof(int32_t) * (header.numFeeds + 1));
+    header.contentFractionOffset =
+        align(header.contentComponentOffset + sizeof(int32_t) * header.numContent);
+    uint64_t arraysEnd = header.contentFractionOffset + sizeof(double) * header.numContent;
+
+    BinaryLimits limits;
+    memset(&limits, 0, sizeof(limits));
+    if (withLimits) {
+        limits.numRatios = problem.numRatios();
+        limits.numRatioEntries = problem.ratioFeed.size();
+        limits.reqMaxOffset = align(arraysEnd);
+        limits.availableOffset = align(limits.reqMaxOffset + sizeof(double) * header.numComponents);
+        limits.ratioLowOffset = align(limits.availableOffset + sizeof(double) * header.numFeeds);
+        limits.ratioHighOffset = align(limits.ratioLowOffset + sizeof(double) * limits.numRatios);
+        limits.ratioOfTotalOffset = align(limits.ratioHighOffset + sizeof(double) * limits.numRatios);
+        limits.ratioStartOffset =
+            align(limits.ratioOfTotalOffset + sizeof(int32_t) * limits.numRatios);
+        limits.ratioFeedOffset =
+            align(limits.ratioStartOffset + sizeof(int32_t) * (limits.numRatios + 1));
+        limits.ratioPartOffset =
+            align(limits.ratioFeedOffset + sizeof(int32_t) * limits.numRatioEntries);
+        arraysEnd = limits.ratioPartOffset + sizeof(int32_t) * limits.numRatioEntries;
+    }
+    header.namesOffset = align(arraysEnd);
+
+    string names;
+    for (const string &name : problem.feedNames) {
+        names.append(name).push_back('\0');
+    }
+    for (const string &name : problem.componentNames) {
+        names.append(name).push_back('\0');
+    }
+    header.namesBytes = names.size();
+
+    image.assign(header.namesOffset + header.namesBytes, 0);
+    memcpy(&image[0], &header, sizeof(header));
+    memcpy(&image[header.costOffset], problem.cost.data(), sizeof(double) * header.numFeeds);
+    memcpy(&image[header.reqMinOffset], problem.reqMin.data(), sizeof(double) * header.numComponents);
+    memcpy(&image[header.contentStartOffset], problem.contentStart.data(),
+           sizeof(int32_t) * (header.numFeeds + 1));
+    memcpy(&image[header.contentComponentOffset], problem.contentComponent.data(),
+           sizeof(int32_t) * header.numContent);
+    if (problem.contentFloat.empty()) {
+        memcpy(&image[header.contentFractionOffset], problem.contentFraction.data(),
+               sizeof(double) * header.numContent);
+    } else {
+        for (uint64_t k = 0; k < header.numContent; ++k) {
+            double fraction = problem.fraction(k);
+            memcpy(&image[header.contentFractionOffset + sizeof(double) * k], &fraction,
+                   sizeof(double));
+        }
+    }
+    if (withLimits) {
+        auto put = [&](uint64_t offset, const void *data, size_t bytes) {
+            if (bytes > 0) {
+                memcpy(&image[offset], data, bytes);
+            }
+        };
+        memcpy(&image[sizeof(header)], &limits, sizeof(limits));
+        put(limits.reqMaxOffset, problem.reqMax.data(), sizeof(double) * header.numComponents);
+        put(limits.availableOffset, problem.available.data(), sizeof(double) * header.numFeeds);
+        put(limits.ratioLowOffset, problem.ratioLow.data(), sizeof(double) * limits.numRatios);
+        put(limits.ratioHighOffset, problem.ratioHigh.data(), sizeof(double) * limits.numRatios);
+        put(limits.ratioOfTotalOffset, problem.ratioOfTotal.data(),
+            sizeof(int32_t) * limits.numRatios);
+        put(limits.ratioStartOffset, problem.ratioStart.data(),
+            sizeof(int32_t) * (limits.numRatios + 1));
+        put(limits.ratioFeedOffset, problem.ratioFeed.data(),
+            sizeof(int32_t) * limits.numRatioEntries);
+        put(limits.ratioPartOffset, problem.ratioPart.data(),
+            sizeof(int32_t) * limits.numRatioEntries);
+    }
+    memcpy(&image[header.namesOffset], names.data(), names.size());
+}
+
+bool writeBinaryProblem(const char *path, const BlendProblem &problem, string &error) {
+    vector<char> image;
+    binaryProblemImage(problem, image);
+    return writeWholeFile(path, image.data(), image.size(), error);
+}
+
+// A binary problem file mapped read-only into memory. view() points straight
+// into the mapping, so building a model from it copies nothing but what CLP
+// itself copies. The view stays valid as long as the MappedProblem lives.
+// Only callers that build straight from view() get that; --data goes through
+// loadBinaryProblem() and copies the arrays into a BlendProblem.
+// attach() reads an image that is already in memory the same way.
+class MappedProblem {
+public:
+    MappedProblem() = default;
+    MappedProblem(const MappedProblem &) = delete;
+    MappedProblem &operator=(const MappedProblem &) = delete;
+    ~MappedProblem() {
+        if (base_ && mapped_) {
+            munmap(base_, size_);
+        }
+    }
+
+    bool open(const char *path, string &error) {
+        int fd = ::open(path, O_RDONLY);
+        if (fd < 0) {
+            error = string("cannot open ") + path + ": " + strerror(errno);
+            return false;
+        }
+        struct stat info;
+        if (fstat(fd, &info) != 0 || info.st_size < static_cast<off_t>(sizeof(BinaryHeader))) {
+            error = string(path) + " is too small for a binary problem";
+            close(fd);
+            return false;
+        }
+        size_ = info.st_size;
+        void *mapped = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (mapped == MAP_FAILED) {
+            error = string("mmap failed: ") + strerror(errno);
+            return false;
+        }
+        base_ = static_cast<char *>(mapped);
+        mapped_ = true;
+        return validate(error);
+    }
+
+    // `image` (8-byte aligned) must outlive the MappedProblem
+    bool attach(const char *image, size_t size, string &error) {
+        if (size < sizeof(BinaryHeader)) {
+            error = "image is too small for a binary problem";
+            return false;
+        }
+        base_ = const_cast<char *>(image);
+        size_ = size;
+        return validate(error);
+    }
+
+    const BinaryHeader &header() const { return *reinterpret_cast<const BinaryHeader *>(base_); }
+
+    // The limits block of a version 2 file, null for version 1
+    const BinaryLimits *limits() const {
+        return memcmp(header().magic, BINARY_MAGIC_LIMITS, sizeof(BINARY_MAGIC_LIMITS)) == 0
+                   ? reinterpret_cast<const BinaryLimits *>(base_ + sizeof(BinaryHeader))
+                   : nullptr;
+    }
+
+    ProblemView view(double dropTolerance = 0.0) const {
+        const BinaryHeader &h = header();
+        ProblemView view{static_cast<int>(h.numFeeds), static_cast<int>(h.numComponents),
+                         static_cast<int>(h.numContent), at<double>(h.costOffset),
+                         at<double>(h.reqMinOffset), h.totalBlend,
+                         at<int>(h.contentStartOffset), at<int>(h.contentComponentOffset),
+                         at<double>(h.contentFractionOffset), dropTolerance};
+        if (const BinaryLimits *l = limits()) {
+            view.reqMax = at<double>(l->reqMaxOffset);
+            view.available = at<double>(l->availableOffset);
+            view.numRatios = static_cast<int>(l->numRatios);
+            view.ratioLow = at<double>(l->ratioLowOffset);
+            view.ratioHigh = at<double>(l->ratioHighOffset);
+            view.ratioOfTotal = at<int>(l->ratioOfTotalOffset);
+            view.ratioStart = at<int>(l->ratioStartOffset);
+            view.ratioFeed = at<int>(l->ratioFeedOffset);
+            view.ratioPart = at<int>(l->ratioPartOffset);
+        }
+        return view;
+    }
+
+    // Feed names followed by component names, each NUL-terminated
+    const char *names() const { return base_ + header().namesOffset; }
+
+private:
+    template <class T>
+    const T *at(uint64_t offset) const {
+        return reinterpret_cast<const T *>(base_ + offset);
+    }
+
+    bool validate(string &error) {
+        const BinaryHeader &h = header();
+        auto fits = [&](uint64_t offset, uint64_t bytes) {
+            return offset % 8 == 0 && offset <= size_ && bytes <= size_ - offset;
+        };
+        bool withLimits = memcmp(h.magic, BINARY_MAGIC_LIMITS, sizeof(h.magic)) == 0;
+        bool ok = (withLimits || memcmp(h.magic, BINARY_MAGIC, sizeof(h.magic)) == 0) &&
+                  (!withLimits || size_ >= sizeof(BinaryHeader) + sizeof(BinaryLimits)) &&
+                  h.numContent <= INT32_MAX && h.numFeeds < INT32_MAX &&
+                  h.numComponents < INT32_MAX &&
+                  fits(h.costOffset, sizeof(double) * uint64_t(h.numFeeds)) &&
+                  fits(h.reqMinOffset, sizeof(double) * uint64_t(h.numComponents)) &&
+                  fits(h.contentStartOffset, sizeof(int32_t) * (uint64_t(h.numFeeds) + 1)) &&
+                  fits(h.contentComponentOffset, sizeof(int32_t) * h.numContent) &&
+                  fits(h.contentFractionOffset, sizeof(double) * h.numContent) &&
+                  fits(h.namesOffset, h.namesBytes);
+        if (ok) {
+            // The builder sizes its arena and CLP's row indices from these
+            const int *start = at<int>(h.contentStartOffset);
+            const int *component = at<int>(h.contentComponentOffset);
+            ok = start[0] == 0 && static_cast<uint64_t>(start[h.numFeeds]) == h.numContent;
+            for (uint64_t i = 0; ok && i < h.numFeeds; ++i) {
+                ok = start[i] <= start[i + 1];
+            }
+            for (uint64_t k = 0; ok && k < h.numContent; ++k) {
+                ok = component[k] >= 0 && static_cast<uint64_t>(component[k]) < h.numComponents;
+            }
+        }
+        if (ok && withLimits) {
+            const BinaryLimits &l = *limits();
+            ok = l.numRatios < INT32_MAX && l.numRatioEntries <= INT32_MAX &&
+                 fits(l.reqMaxOffset, sizeof(double) * uint64_t(h.numComponents)) &&
+                 fits(l.availableOffset, sizeof(double) * uint64_t(h.numFeeds)) &&
+                 fits(l.ratioLowOffset, sizeof(double) * l.numRatios) &&
+                 fits(l.ratioHighOffset, sizeof(double) * l.numRatios) &&
+                 fits(l.ratioOfTotalOffset, sizeof(int32_t) * l.numRatios) &&
+                 fits(l.ratioStartOffset, sizeof(int32_t) * (l.numRatios + 1)) &&
+                 fits(l.ratioFeedOffset, sizeof(int32_t) * l.numRatioEntries) &&
+                 fits(l.ratioPartOffset, sizeof(int32_t) * l.numRatioEntries);
+            if (ok) {
+                // The builder indexes columns with these, so check them all
+                const int *start = at<int>(l.ratioStartOffset);
+                const int *feed = at<int>(l.ratioFeedOffset);
+                ok = start[0] == 0 && static_cast<uint64_t>(start[l.numRatios]) == l.numRatioEntries;
+                for (uint64_t r = 0; ok && r < l.numRatios; ++r) {
+                    ok = start[r] <= start[r + 1];
+                }
+                for (uint64_t k = 0; ok && k < l.numRatioEntries; ++k) {
+                    ok = feed[k] >= 0 && static_cast<uint64_t>(feed[k]) < h.numFeeds;
+                }
+            }
+        }
+        if (!ok) {
+            error = "not a valid binary problem file";
+        }
+        return ok;
+    }
+
+    char *base_ = nullptr;
+    size_t size_ = 0;
+    bool mapped_ = false;  // base_ is ours to unmap
+};
+
+// Copies a mapped problem into `problem` (which should be empty). The arrays
+// are bulk copies; nothing is parsed.
+bool copyMappedProblem(const MappedProblem &mapped, BlendProblem &problem, string &error) {
+    ProblemView data = mapped.view();
+
+    const char *name = mapped.names();
+    const char *namesEnd = name + mapped.header().namesBytes;
+    for (int k = 0; k < data.numFeeds + data.numComponents; ++k) {
+        const char *nul = static_cast<const char *>(memchr(name, '\0', namesEnd - name));
+        if (!nul) {
+            error = "truncated name table";
+            return false;
+        }
+        if (k < data.numFeeds) {
+            problem.internFeed(string(name, nul));
+        } else {
+            problem.internComponent(string(name, nul));
+        }
+        name = nul + 1;
+    }
+    if (problem.numFeeds() != data.numFeeds || problem.numComponents() != data.numComponents) {
+        error = "duplicate names in name table";
+        return false;
+    }
+
+    problem.cost.assign(data.cost, data.cost + data.numFeeds);
+    problem.reqMin.assign(data.reqMin, data.reqMin + data.numComponents);
+    problem.totalBlend = data.totalBlend;
+    problem.contentStart.assign(data.contentStart, data.contentStart + data.numFeeds + 1);
+    problem.contentComponent.assign(data.contentComponent, data.contentComponent + data.numContent);
+    problem.contentFraction.assign(data.contentFraction, data.contentFraction + data.numContent);
+    if (data.reqMax) {
+        int numEntries = data.ratioStart[data.numRatios];
+        problem.reqMax.assign(data.reqMax, data.reqMax + data.numComponents);
+        problem.available.assign(data.available, data.available + data.numFeeds);
+        problem.ratioLow.assign(data.ratioLow, data.ratioLow + data.numRatios);
+        problem.ratioHigh.assign(data.ratioHigh, data.ratioHigh + data.numRatios);
+        problem.ratioOfTotal.assign(data.ratioOfTotal, data.ratioOfTotal + data.numRatios);
+        problem.ratioStart.assign(data.ratioStart, data.ratioStart + data.numRatios + 1);
+        problem.ratioFeed.assign(data.ratioFeed, data.ratioFeed + numEntries);
+        problem.ratioPart.assign(data.ratioPart, data.ratioPart + numEntries);
+    }
+    return true;
+}
+
+// Loads a binary problem file into an owned BlendProblem. This is one bulk
+// copy per array rather than zero-copy: scenarios, the live model and the
+// result writers all patch or outlive the problem, so they need it owned.
+bool loadBinaryProblem(const char *path, BlendProblem &problem, string &error) {
+    MappedProblem mapped;
+    return mapped.open(path, error) && copyMappedProblem(mapped, problem, error);
+}
+
+// The same from an image made by binaryProblemImage()
+bool loadBinaryImage(const char *image, size_t size, BlendProblem &problem, string &error) {
+    MappedProblem mapped;
+    return mapped.attach(image, size, error) && copyMappedProblem(mapped, problem, error);
+}
+
+// Loads a binary problem file (recognized by its magic) or a CSV file.
+bool loadProblemFile(const char *path, BlendProblem &problem, string &error) {
+    BLENDER_TIME_PHASE(PHASE_LOAD);
+    char magic[sizeof(BINARY_MAGIC)] = {0};
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        error = string("cannot open ") + path + ": " + strerror(errno);
+        return false;
+    }
+    ssize_t got = read(fd, magic, sizeof(magic));
+    close(fd);
+    if (got == sizeof(magic) && (memcmp(magic, BINARY_MAGIC, sizeof(magic)) == 0 ||
+                                 memcmp(magic, BINARY_MAGIC_LIMITS, sizeof(magic)) == 0)) {
+        return loadBinaryProblem(path, problem, error);
+    }
+    return loadCsvProblem(path, problem, error);
+}
+
+
+// Result archive: the solutions of a batch, written once and then read back
+// one scenario at a time by ID without parsing anything. Layout:
+//   ArchiveHeader
+//   ArchiveEntry[numScenarios]  fixed stride, scenario ID s at s - 1
+//   blocks                      one per written scenario, 8-byte aligned:
+//                               double duals[numRows], double values[n],
+//                               int32 columns[n] for its n nonzero columns
+// When the number of scenarios is known up front (ResultArchiveWriter's
+// capacity) the index is preallocated behind the header and writers fill it
+// in place; otherwise it is kept in memory and appended after the blocks on
+// close(). Either way blocks are only ever appended, at offsets handed out
+// by an atomic counter, so writer threads never wait for each other. The
+// header is patched last: indexOffset 0 marks an archive that was never
+// closed.
+const char ARCHIVE_MAGIC[8] = {'B', 'L', 'N', 'D', 'R', 'E', 'S', '1'};
+
+struct ArchiveHeader {
+    char magic[8];
+    uint64_t numScenarios;
+    uint64_t indexOffset;
+    int32_t numColumns;
+    int32_t numRows;
+};
+
+struct ArchiveEntry {
+    uint64_t offset;  // of the block
+    double objective;
+    int32_t status;
+    int32_t iterations;
+    uint32_t numNonzeros;
+    uint32_t written;  // 0 for IDs no solve was written for
+};
+
+// Appends the block of the solve in `model` to `blocks` and fills in
+// `entry`, its offset relative to the start of `blocks`.
+void appendArchiveBlock(const ClpSimplex &model, vector<char> &blocks, ArchiveEntry &entry) {
+    int numColumns = model.numberColumns();
+    int numRows = model.numberRows();
+    entry = ArchiveEntry();
+    entry.offset = blocks.size();
+    entry.status = model.status();
+    entry.iterations = model.numberIterations();
+    entry.objective = model.isProvenOptimal() ? model.getObjValue() : NAN;
+    entry.written = 1;
+
+    const double *solution = model.getColSolution();
+    vector<double> values(model.getRowPrice(), model.getRowPrice() + numRows);
+    vector<int32_t> columns;
+    for (int i = 0; i < numColumns; ++i) {
+        if (solution[i] != 0.0) {
+            values.push_back(solution[i]);
+            columns.push_back(i);
+        }
+    }
+    entry.numNonzeros = columns.size();
+    columns.resize((columns.size() + 1) / 2 * 2);  // pad to 8 bytes
+    const char *valueBytes = reinterpret_cast<const char *>(values.data());
+    const char *columnBytes = reinterpret_cast<const char *>(columns.data());
+    blocks.insert(blocks.end(), valueBytes, valueBytes + values.size() * sizeof(double));
+    blocks.insert(blocks.end(), columnBytes, columnBytes + columns.size() * sizeof(int32_t));
+}
+
+// Writes `size` bytes at `offset`, retrying short writes.
+bool writeAt(int fd, const void *data, size_t size, uint64_t offset) {
+    size_t written = 0;
+    while (written < size) {
+        ssize_t put = pwrite(fd, static_cast<const char *>(data) + written, size - written,
+                             offset + written);
+        if (put < 0 && errno == EINTR) {
+            continue;
+        }
+        if (put < 0) {
+            return false;
+        }
+        written += put;
+    }
+    return true;
+}
+
+class ResultArchiveWriter {
+public:
+    ResultArchiveWriter() = default;
+    ResultArchiveWriter(const ResultArchiveWriter &) = delete;
+    ResultArchiveWriter &operator=(const ResultArchiveWriter &) = delete;
+    ~ResultArchiveWriter() {
+        if (fd_ >= 0) {
+            ::close(fd_);
+        }
+    }
+
+    // `capacity` is the number of scenarios, 0 if it is not known yet
+    bool create(const char *path, int numColumns, int numRows, uint64_t capacity, string &error) {
+        fd_ = ::open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd_ < 0) {
+            error = string("cannot create ") + path + ": " + strerror(errno);
+            return false;
+        }
+        memset(&header_, 0, sizeof(header_));
+        memcpy(header_.magic, ARCHIVE_MAGIC, sizeof(header_.magic));
+        header_.numScenarios = capacity;
+        header_.numColumns = numColumns;
+        header_.numRows = numRows;
+        uint64_t dataOffset = sizeof(header_) + capacity * sizeof(ArchiveEntry);
+        end_.store(dataOffset);
+        // The preallocated index reads as zeros (nothing written) until filled
+        if (!writeAt(fd_, &header_, sizeof(header_), 0) || ftruncate(fd_, dataOffset) != 0) {
+            error = string("write failed: ") + strerror(errno);
+            return false;
+        }
+        return true;
+    }
+
+    // Appends the solve in `model` as scenario `id` (1-based). Safe to call
+    // from any thread when a capacity was given, from one thread otherwise.
+    bool write(uint64_t id, const ClpSimplex &model) {
+        int numColumns = model.numberColumns();
+        int numRows = model.numberRows();
+        if (id == 0 || (header_.numScenarios > 0 && id > header_.numScenarios) ||
+            numColumns != header_.numColumns || numRows != header_.numRows) {
+            return fail("scenario " + to_string(id) + " does not fit the archive");
+        }
+        ArchiveEntry entry;
+        vector<char> block;
+        appendArchiveBlock(model, block, entry);
+        entry.offset = end_.fetch_add(block.size());
+        if (!writeAt(fd_, block.data(), block.size(), entry.offset)) {
+            return fail(string("write failed: ") + strerror(errno));
+        }
+
+        if (header_.numScenarios > 0) {
+            if (!writeAt(fd_, &entry, sizeof(entry),
+                         sizeof(header_) + (id - 1) * sizeof(ArchiveEntry))) {
+                return fail(string("write failed: ") + strerror(errno));
+            }
+        } else {
+            if (index_.size() < id) {
+                index_.resize(id);
+            }
+            index_[id - 1] = entry;
+        }
+        return true;
+    }
+
+    // Writes the in-memory index (if any) and the final header
+    bool close(string &error) {
+        if (!error_.empty()) {
+            error = error_;
+            return false;
+        }
+        if (header_.numScenarios > 0) {
+            header_.indexOffset = sizeof(header_);
+        } else {
+            header_.numScenarios = index_.size();
+            header_.indexOffset = end_.load();
+            if (!writeAt(fd_, index_.data(), index_.size() * sizeof(ArchiveEntry),
+                         header_.indexOffset)) {
+                error = string("write failed: ") + strerror(errno);
+                return false;
+            }
+        }
+        if (!writeAt(fd_, &header_, sizeof(header_), 0) || ::close(fd_) != 0) {
+            error = string("write failed: ") + strerror(errno);
+            fd_ = -1;
+            return false;
+        }
+        fd_ = -1;
+        return true;
+    }
+
+private:
+    bool fail(const string &message) {
+        lock_guard<mutex> lock(errorMutex_);
+        if (error_.empty()) {
+            error_ = message;
+        }
+        return false;
+    }
+
+    int fd_ = -1;
+    ArchiveHeader header_;
+    atomic<uint64_t> end_{0};
+    vector<ArchiveEntry> index_;  // without a capacity
+    mutex errorMutex_;
+    string error_;              // first failed write()
+};
+
+// One archived scenario; the pointers go straight into the mapping
+struct ArchivedResult {
+    int status;
+    int iterations;
+    double objective;
+    uint32_t numNonzeros;
+    const int32_t *columns;  // the nonzero columns of the solution
+    const double *values;    // and their values
+    const double *duals;     // numRows() of them
+};
+
+// A result archive mapped read-only. Only the pages of the scenarios looked
+// at are ever read, so archives far larger than memory are fine.
+class ResultArchive {
+public:
+    ResultArchive() = default;
+    ResultArchive(const ResultArchive &) = delete;
+    ResultArchive &operator=(const ResultArchive &) = delete;
+    ~ResultArchive() {
+        if (base_) {
+            munmap(base_, size_);
+        }
+    }
+
+    bool open(const char *path, string &error) {
+        int fd = ::open(path, O_RDONLY);
+        if (fd < 0) {
+            error = string("cannot open ") + path + ": " + strerror(errno);
+            return false;
+        }
+        struct stat info;
+        if (fstat(fd, &info) != 0 || info.st_size < static_cast<off_t>(sizeof(ArchiveHeader))) {
+            error = string(path) + " is too small for a result archive";
+            ::close(fd);
+            return false;
+        }
+        size_ = info.st_size;
+        void *mapped = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (mapped == MAP_FAILED) {
+            error = string("mmap failed: ") + strerror(errno);
+            return false;
+        }
+        base_ = static_cast<char *>(mapped);
+        madvise(base_, size_, MADV_RANDOM);
+
+        const ArchiveHeader &h = header();
+        if (memcmp(h.magic, ARCHIVE_MAGIC, sizeof(h.magic)) != 0) {
+            error = "not a result archive";
+            return false;
+        }
+        if (h.indexOffset == 0) {
+            error = "result archive was not closed";
+            return false;
+        }
+        if (h.numColumns < 0 || h.numRows < 0 || h.indexOffset % 8 != 0 || h.indexOffset > size_ ||
+            h.numScenarios > (size_ - h.indexOffset) / sizeof(ArchiveEntry)) {
+            error = "not a valid result archive";
+            return false;
+        }
+        return true;
+    }
+
+    const ArchiveHeader &header() const { return *reinterpret_cast<const ArchiveHeader *>(base_); }
+    uint64_t numScenarios() const { return header().numScenarios; }
+    int numColumns() const { return header().numColumns; }
+    int numRows() const { return header().numRows; }
+
+    // Scenario `id` (1-based); false if it is out of range, was never
+    // written or its block lies outside the file
+    bool scenario(uint64_t id, ArchivedResult &result) const {
+        if (id == 0 || id > numScenarios()) {
+            return false;
+        }
+        const ArchiveEntry &entry =
+            reinterpret_cast<const ArchiveEntry *>(base_ + header().indexOffset)[id - 1];
+        uint64_t valuesBytes =
+            (static_cast<uint64_t>(numRows()) + entry.numNonzeros) * sizeof(double);
+        if (!entry.written || entry.offset % 8 != 0 || entry.offset > size_ ||
+            valuesBytes + entry.numNonzeros * sizeof(int32_t) > size_ - entry.offset) {
+            return false;
+        }
+        const double *block = reinterpret_cast<const double *>(base_ + entry.offset);
+        result.status = entry.status;
+        result.iterations = entry.iterations;
+        result.objective = entry.objective;
+        result.numNonzeros = entry.numNonzeros;
+        result.duals = block;
+        result.values = block + numRows();
+        result.columns = reinterpret_cast<const int32_t *>(base_ + entry.offset + valuesBytes);
+        return true;
+    }
+
+private:
+    char *base_ = nullptr;
+    size_t size_ = 0;
+};
+
+#endif
+
+
+// --- 2. MODEL BUILDER: Columns, rows and the constraint matrix ---
+
+// Solver settings from the command line. main() sets them before any model
+// is built; afterwards they are only read, from any thread.
+struct SolveOptions {
+    bool presolve = true;        // run ClpPresolve before cold solves
+    bool presolveCache = false;  // batch: presolve once and reuse it (PresolveCache)
+    bool checkPresolveCache = false;  // ... and compare every cached solve with a fresh one
+    int scaling = 3;             // ClpModel::scaling(): 0 off, 1 equilibrium, 2 geometric, 3 auto
+    bool smallKernel = false;    // batch: solve small problems with SmallBlendKernel
+    size_t resultCacheBytes = 0; // batch: SolveCache size, 0 = no result cache
+    int stallIterations = 1000;  // iterations without progress before a stall remedy, 0 = off
+    bool compactResults = false; // batch: CompactResults cache entries, float32 content
+    const char *basisDir = nullptr;  // single and multi-period solves: basis store directory
+    Algorithm algorithm = ALGORITHM_AUTO;  // cold solves
+    int barrierThreads = 0;      // Cholesky threads (PARDISO builds), 0 = one per core
+    int racers = 0;              // single and multi-period solves: raceSolve() entrants, 0 = off
+};
+
+SolveOptions solveOptions;
+
+#if !BLENDER_EMBEDDED  // the builder
+
+// A fraction of the blend in units; +-1.0e+20 (no limit) stays as it is
+inline double perBlend(double fraction, double total) {
+    return fabs(fraction) >= 1.0e+20 ? fraction : fraction * total;
+}
+
+// One row a ratio limit normalizes to. A share of the whole blend is one
+// ranged row, sum_numerator x in [low T, high T]; any other ratio is one row
+// per finite bound, sum_numerator x - bound * sum_denominator x >= 0 (low)
+// or <= 0 (high), so no ratio ever needs an auxiliary column.
+struct RatioRow {
+    int ratio;
+    bool share;     // bounds are fractions of the total blend
+    double factor;  // `bound` above, subtracted for each denominator feed
+    double lower, upper;
+};
+
+void ratioRows(const ProblemView &problem, vector<RatioRow> &rows) {
+    rows.clear();
+    for (int r = 0; r < problem.numRatios; ++r) {
+        double low = problem.ratioLow[r];
+        double high = problem.ratioHigh[r];
+        if (problem.ratioOfTotal[r]) {
+            if (low > 0.0 || high < 1.0e+20) {
+                rows.push_back(RatioRow{r, true, 0.0, low, high});
+            }
+            continue;
+        }
+        if (low > 0.0) {
+            rows.push_back(RatioRow{r, false, low, 0.0, 1.0e+20});
+        }
+        if (high < 1.0e+20) {
+            rows.push_back(RatioRow{r, false, high, -1.0e+20, 0.0});
+        }
+    }
+}
+
+// Coefficient of entry k of a ratio limit in one of its rows
+inline double ratioCoefficient(const ProblemView &problem, const RatioRow &row, int k) {
+    int part = problem.ratioPart[k];
+    return ((part & RATIO_NUMERATOR) ? 1.0 : 0.0) - ((part & RATIO_DENOMINATOR) ? row.factor : 0.0);
+}
+
+// Loads a blend problem into an empty model. Column i is feed i, bounded by
+// its availability; row 0 is the total flow, row j + 1 is component j as one
+// ranged row [reqMin_j T, reqMax_j T], and the ratio rows (see RatioRow)
+// follow in limit order.
+//
+// The matrix is emitted directly in compressed sparse column (CSC) form: feed
+// i's column is the total-flow coefficient followed by its nonzero content
+// fractions, which the sparse feed-major content list already stores in that
+// order. Everything is sized exactly before it is filled and handed to CLP in
+// one loadProblem call, so CLP never has to grow or reorder its matrix. All
+// scratch arrays come from `arena`, which is reset at the start of each build.
+void buildModel(ClpSimplex &model, const ProblemView &problem, BuildArena &arena) {
+    BLENDER_TIME_PHASE(PHASE_BUILD);
+    arena.reset();
+
+    // --- 3. VARIABLES: Set up columns (variables) ---
+    int numVars = problem.numFeeds; // one variable x_i per feed
+    int numComponents = problem.numComponents;
+    
+    // Set variable bounds (lower bound = 0, upper bound = availability)
+    // All variables are non-negative (x >= 0)
+    double *columnLower = arena.allocate<double>(numVars);
+    double *columnUpper = arena.allocate<double>(numVars);
+    double *objective = arena.allocate<double>(numVars);
+
+    for (int i = 0; i < numVars; ++i) {
+        columnLower[i] = 0.0;
+        columnUpper[i] = problem.available ? problem.available[i] : 1.0e+20; // 1.0e+20: infinity
+        // Set the objective coefficients (the costs)
+        objective[i] = problem.cost[i];
+    }
+
+
+    // --- 4. CONSTRAINTS: Set up rows ---
+    
+    // Row bounds (lower and upper limits for the constraints)
+    // Row 0: Total Flow (Equality: lower = upper = totalBlend)
+    // Row j + 1: Component j (Ranged: reqMin[j] * totalBlend to reqMax[j] * totalBlend)
+    // Rows after that: ratio limits
+    vector<RatioRow> ratios;
+    if (problem.numRatios > 0) {
+        ratioRows(problem, ratios);
+    }
+    int numRatioRows = ratios.size();
+    int numRows = numComponents + 1 + numRatioRows;
+    double *rowLower = arena.allocate<double>(numRows);
+    double *rowUpper = arena.allocate<double>(numRows);
+
+    // Constraint 0: Total Flow (Sum(x_i) = 100.0)
+    rowLower[0] = problem.totalBlend;
+    rowUpper[0] = problem.totalBlend;
+
+    // Constraints 1..: Components (Sum(x_i * C_ij) >= e.g. 0.40 * 100.0 = 40.0)
+    for (int j = 0; j < numComponents; ++j) {
+        rowLower[j + 1] = problem.reqMin[j] * problem.totalBlend;
+        rowUpper[j + 1] = problem.reqMax ? perBlend(problem.reqMax[j], problem.totalBlend) : 1.0e+20;
+    }
+    for (int r = 0; r < numRatioRows; ++r) {
+        const RatioRow &row = ratios[r];
+        rowLower[numComponents + 1 + r] =
+            row.share ? perBlend(row.lower, problem.totalBlend) : row.lower;
+        rowUpper[numComponents + 1 + r] =
+            row.share ? perBlend(row.upper, problem.totalBlend) : row.upper;
+    }
+    
+    // 5. Build the Constraint Matrix (A) in CSC form
+    // Every column holds one total-flow entry plus its nonzero contents. The
+    // tolerance may have been raised after loading, so count what survives it.
+    CoinBigIndex numElements = numVars;
+    for (int k = 0; k < problem.numContent; ++k) {
+        if (fabs(problem.fraction(k)) > problem.dropTolerance) {
+            ++numElements;
+        }
+    }
+    // Ratio rows come last in every column, so their entries are bucketed
+    // by feed first (in row order, which keeps each column sorted)
+    int *ratioCount = nullptr;
+    int *ratioRow = nullptr;
+    double *ratioValue = nullptr;
+    if (numRatioRows > 0) {
+        ratioCount = arena.allocate<int>(numVars + 1);
+        fill(ratioCount, ratioCount + numVars + 1, 0);
+        int numRatioEntries = 0;
+        for (const RatioRow &row : ratios) {
+            for (int k = problem.ratioStart[row.ratio]; k < problem.ratioStart[row.ratio + 1]; ++k) {
+                if (ratioCoefficient(problem, row, k) != 0.0) {
+                    ++ratioCount[problem.ratioFeed[k] + 1];
+                    ++numRatioEntries;
+                }
+            }
+        }
+        for (int i = 0; i < numVars; ++i) {
+            ratioCount[i + 1] += ratioCount[i]; // now the start of feed i + 1's bucket
+        }
+        ratioRow = arena.allocate<int>(numRatioEntries);
+        ratioValue = arena.allocate<double>(numRatioEntries);
+        int *fillAt = arena.allocate<int>(numVars);
+        copy(ratioCount, ratioCount + numVars, fillAt);
+        for (int r = 0; r < numRatioRows; ++r) {
+            const RatioRow &row = ratios[r];
+            for (int k = problem.ratioStart[row.ratio]; k < problem.ratioStart[row.ratio + 1]; ++k) {
+                double value = ratioCoefficient(problem, row, k);
+                if (value != 0.0) {
+                    int at = fillAt[problem.ratioFeed[k]]++;
+                    ratioRow[at] = numComponents + 1 + r;
+                    ratioValue[at] = value;
+                }
+            }
+        }
+        numElements += numRatioEntries;
+    }
+    CoinBigIndex *columnStarts = arena.allocate<CoinBigIndex>(numVars + 1);
+    int *rowIndices = arena.allocate<int>(numElements);
+    double *elements = arena.allocate<double>(numElements);
+
+    CoinBigIndex next = 0;
+    for (int i = 0; i < numVars; ++i) {
+        columnStarts[i] = next;
+
+        // A. Total Flow Constraint (coefficient 1 in row 0)
+        rowIndices[next] = 0;
+        elements[next] = 1.0;
+        ++next;
+
+        // B. Component Constraints (coefficient C_ij in row j + 1, zeros dropped)
+        for (int k = problem.contentStart[i]; k < problem.contentStart[i + 1]; ++k) {
+            double fraction = problem.fraction(k);  // widened here, if held as float32
+            if (fabs(fraction) > problem.dropTolerance) {
+                rowIndices[next] = problem.contentComponent[k] + 1;
+                elements[next] = fraction;
+                ++next;
+            }
+        }
+
+        // C. Ratio rows (see RatioRow)
+        if (ratioCount) {
+            for (int k = ratioCount[i]; k < ratioCount[i + 1]; ++k) {
+                rowIndices[next] = ratioRow[k];
+                elements[next] = ratioValue[k];
+                ++next;
+            }
+        }
+    }
+    columnStarts[numVars] = next;
+
+    // Load columns, rows and matrix in one go (loadProblem copies the arrays,
+    // so the arena can be reused as soon as it returns)
+    model.loadProblem(numVars, numRows, columnStarts, rowIndices, elements,
+                      columnLower, columnUpper, objective, rowLower, rowUpper);
+
+    // Set the problem direction: Minimize (default) or Maximize
+    model.setObjSense(1.0); // 1.0 for minimization, -1.0 for maximization
+
+    model.scaling(solveOptions.scaling);
+
+    CountingEventHandler counter;
+    model.passInEventHandler(&counter);
+}
+
+void buildModel(ClpSimplex &model, const BlendProblem &problem, BuildArena &arena) {
+    buildModel(model, problem.view(), arena);
+}
+
+#endif
+
+
+// Loads a compiled recipe image (see section 1a). The arrays are read in
+// place; only CLP's own copy is allocated.
+template <int NF, int NC>
+void loadImage(ClpSimplex &model, const CscImage<NF, NC> &image) {
+    BLENDER_TIME_PHASE(PHASE_BUILD);
+    model.loadProblem(image.NUM_COLUMNS, image.NUM_ROWS, image.columnStarts, image.rowIndices,
+                      image.elements, image.columnLower, image.columnUpper, image.objective,
+                      image.rowLower, image.rowUpper);
+    model.setObjSense(1.0);
+    model.scaling(solveOptions.scaling);
+
+    CountingEventHandler counter;
+    model.passInEventHandler(&counter);
+}
+
+
+#if !BLENDER_EMBEDDED  // sections 7 to 14
+
+// --- 7. RESULT WRITER: Buffered table and NDJSON output ---
+
+// The outcome of one scenario solve.
+struct ScenarioResult {
+    int status;        // ClpSimplex::status(), 0 = optimal
+    double objective;
+    int iterations;
+};
+
+// Optimal total cost as a function of one feed's price (see costCurve). On
+// each segment the optimal basis, and so the feed quantity, is fixed and the
+// cost rises linearly with slope `quantity`; segments meet at the prices
+// where the basis changes.
+struct CostSegment {
+    double priceFrom;
+    double priceTo;
+    double quantity;       // optimal amount of the feed on this segment
+    double objectiveFrom;  // optimal total cost at priceFrom
+};
+
+// Intervals over which the current basis stays optimal (see rangeModel):
+// feed prices, and the right-hand side of each row (total flow, then the
+// minimum of each component). Unbounded ends are +-infinity.
+struct Ranging {
+    vector<double> costLow, costHigh;
+    vector<double> rhs, rhsLow, rhsHigh;
+};
+
+// Output formats: a human-readable table, or newline-delimited JSON with one
+// object per solve for downstream tools.
+enum OutputFormat {
+    OUTPUT_TABLE,
+    OUTPUT_NDJSON
+};
+
+// Formats results into one growing buffer with std::to_chars and hands it to
+// the kernel with a single write(2) once the buffer is full, on flush() and
+// on destruction, instead of flushing a stream per line. Tables print numbers
+// like iostream does (6 significant digits); NDJSON uses the shortest text
+// that reads back to the same double.
+class ResultWriter {
+public:
+    explicit ResultWriter(OutputFormat format, int fd = STDOUT_FILENO,
+                          size_t flushBytes = 4 << 20)
+        : format_(format), fd_(fd), flushBytes_(flushBytes) {
+        buffer_.reserve(flushBytes_ + 4096);
+    }
+    ResultWriter(const ResultWriter &) = delete;
+    ResultWriter &operator=(const ResultWriter &) = delete;
+    ~ResultWriter() { flush(); }
+
+    OutputFormat format() const { return format_; }
+
+    // Full solution: status, objective, feed quantities, reduced costs and
+    // row duals. `scenario` < 0 means a single solve.
+    void writeSolution(long scenario, const ClpSimplex &model, const BlendProblem &problem) {
+        BLENDER_TIME_PHASE(PHASE_EXTRACT);
+        int numFeeds = problem.numFeeds();
+        int numComponents = problem.numComponents();
+        bool optimal = model.isProvenOptimal();
+        const double *solution = model.getColSolution();
+        const double *reducedCost = model.getReducedCost();
+        const double *dual = model.getRowPrice();
+
+        if (format_ == OUTPUT_NDJSON) {
+            append("{");
+            if (scenario >= 0) {
+                append("\"scenario\":");
+                appendInteger(scenario);
+                append(",");
+            }
+            append("\"status\":");
+            appendInteger(model.status());
+            append(",\"objective\":");
+            appendNumber(optimal ? model.getObjValue() : NAN);
+            append(",\"iterations\":");
+            appendInteger(model.numberIterations());
+            if (optimal) {
+                appendArray("x", solution, numFeeds);
+                appendArray("reduced_cost", reducedCost, numFeeds);
+                appendArray("dual", dual, numComponents + 1);
+            }
+            append("}\n");
+            flushIfFull();
+            return;
+        }
+
+        if (scenario >= 0) {
+            append("Scenario ");
+            appendInteger(scenario);
+            append("\n");
+        }
+        if (!optimal) {
+            append("Status: Not Optimal (");
+            appendInteger(model.status());
+            append(")\n");
+            flushIfFull();
+            return;
+        }
+        append("Status: Optimal\nMinimum Total Cost: $");
+        appendNumber(model.getObjValue());
+        append("\n\nOptimal Feed Quantities:\n");
+        for (int i = 0; i < numFeeds; ++i) {
+            append("  Feed ");
+            append(problem.feedNames[i]);
+            append(": ");
+            appendNumber(solution[i]);
+            append(" units\n");
+        }
+        append("\nReduced Costs ($/unit):\n");
+        for (int i = 0; i < numFeeds; ++i) {
+            append("  Feed ");
+            append(problem.feedNames[i]);
+            append(": ");
+            appendNumber(reducedCost[i]);
+            append("\n");
+        }
+        // Row 0 is the total flow, row j + 1 is component j (see buildModel)
+        append("\nShadow Prices:\n  Total Flow: ");
+        appendNumber(dual[0]);
+        append("\n");
+        for (int j = 0; j < numComponents; ++j) {
+            append("  Component ");
+            append(problem.componentNames[j]);
+            append(": ");
+            appendNumber(dual[j + 1]);
+            append("\n");
+        }
+        flushIfFull();
+    }
+
+    // One-line outcome of a batch scenario.
+    void writeSummary(long scenario, const ScenarioResult &result) {
+        BLENDER_TIME_PHASE(PHASE_EXTRACT);
+        if (format_ == OUTPUT_NDJSON) {
+            append("{\"scenario\":");
+            appendInteger(scenario);
+            append(",\"status\":");
+            appendInteger(result.status);
+            append(",\"objective\":");
+            appendNumber(result.status == 0 ? result.objective : NAN);
+            append(",\"iterations\":");
+            appendInteger(result.iterations);
+            append("}\n");
+        } else if (result.status == 0) {
+            append("Scenario ");
+            appendInteger(scenario);
+            append(": Optimal ");
+            appendNumber(result.objective);
+            append(" (");
+            appendInteger(result.iterations);
+            append(" iterations)\n");
+        } else {
+            append("Scenario ");
+            appendInteger(scenario);
+            append(": Not Optimal (");
+            appendInteger(result.status);
+            append(")\n");
+        }
+        flushIfFull();
+    }
+
+    // Piecewise-linear cost curve of one feed, its breakpoints, and the curve
+    // evaluated at `numPoints` evenly spaced prices (no extra solves).
+    void writeCostCurve(const string &feed, const vector<CostSegment> &segments, int numPoints) {
+        BLENDER_TIME_PHASE(PHASE_EXTRACT);
+        if (segments.empty()) {
+            append(format_ == OUTPUT_NDJSON ? "{\"feed\":\"" : "No optimal cost curve for feed ");
+            append(feed);
+            append(format_ == OUTPUT_NDJSON ? "\",\"segments\":[]}\n" : "\n");
+            return;
+        }
+        double low = segments.front().priceFrom;
+        double high = segments.back().priceTo;
+        auto evaluate = [&](double price, double &quantity) {
+            const CostSegment *on = &segments.back();
+            for (const CostSegment &segment : segments) {
+                if (price <= segment.priceTo) {
+                    on = &segment;
+                    break;
+                }
+            }
+            quantity = on->quantity;
+            return on->objectiveFrom + (price - on->priceFrom) * on->quantity;
+        };
+
+        if (format_ == OUTPUT_NDJSON) {
+            append("{\"feed\":\"");
+            append(feed);
+            append("\",\"segments\":[");
+            for (size_t k = 0; k < segments.size(); ++k) {
+                append(k ? ",{\"from\":" : "{\"from\":");
+                appendNumber(segments[k].priceFrom);
+                append(",\"to\":");
+                appendNumber(segments[k].priceTo);
+                append(",\"quantity\":");
+                appendNumber(segments[k].quantity);
+                append(",\"objective\":");
+                appendNumber(segments[k].objectiveFrom);
+                append("}");
+            }
+            append("],\"breakpoints\":[");
+            for (size_t k = 0; k + 1 < segments.size(); ++k) {
+                if (k) {
+                    append(",");
+                }
+                appendNumber(segments[k].priceTo);
+            }
+            append("],\"points\":[");
+            for (int k = 0; k < numPoints; ++k) {
+                double price = numPoints > 1 ? low + (high - low) * k / (numPoints - 1) : low;
+                double quantity;
+                double objective = evaluate(price, quantity);
+                append(k ? ",[" : "[");
+                appendNumber(price);
+                append(",");
+                appendNumber(objective);
+                append(",");
+                appendNumber(quantity);
+                append("]");
+            }
+            append("]}\n");
+            flushIfFull();
+            return;
+        }
+
+        append("Cost curve for feed ");
+        append(feed);
+        append(" ($/unit from ");
+        appendNumber(low);
+        append(" to ");
+        appendNumber(high);
+        append("):\n");
+        for (const CostSegment &segment : segments) {
+            append("  Price ");
+            appendNumber(segment.priceFrom);
+            append(" to ");
+            appendNumber(segment.priceTo);
+            append(": ");
+            appendNumber(segment.quantity);
+            append(" units, total cost from $");
+            appendNumber(segment.objectiveFrom);
+            append("\n");
+        }
+        append("\nBasis changes at:");
+        for (size_t k = 0; k + 1 < segments.size(); ++k) {
+            append(" ");
+            appendNumber(segments[k].priceTo);
+        }
+        append("\n");
+        if (numPoints > 0) {
+            append("\nMinimum Total Cost by Price:\n");
+        }
+        for (int k = 0; k < numPoints; ++k) {
+            double price = numPoints > 1 ? low + (high - low) * k / (numPoints - 1) : low;
+            double quantity;
+            double objective = evaluate(price, quantity);
+            append("  Price ");
+            appendNumber(price);
+            append(": $");
+            appendNumber(objective);
+            append(" (");
+            appendNumber(quantity);
+            append(" units)\n");
+        }
+        flushIfFull();
+    }
+
+    void writeRanging(const Ranging &ranging, const BlendProblem &problem) {
+        BLENDER_TIME_PHASE(PHASE_EXTRACT);
+        int numFeeds = problem.numFeeds();
+        int numRows = ranging.rhs.size();
+        int numComponents = problem.numComponents();
+        auto rowName = [&](int row) {
+            return row == 0               ? string("Total Flow")
+                   : row <= numComponents ? "Component " + problem.componentNames[row - 1]
+                                          : "Ratio Row " + to_string(row - numComponents - 1);
+        };
+
+        if (format_ == OUTPUT_NDJSON) {
+            append("{\"cost_ranging\":[");
+            for (int i = 0; i < numFeeds; ++i) {
+                append(i ? ",{\"feed\":\"" : "{\"feed\":\"");
+                append(problem.feedNames[i]);
+                append("\",\"cost\":");
+                appendNumber(problem.cost[i]);
+                append(",\"low\":");
+                appendNumber(ranging.costLow[i]);
+                append(",\"high\":");
+                appendNumber(ranging.costHigh[i]);
+                append("}");
+            }
+            append("],\"rhs_ranging\":[");
+            for (int row = 0; row < numRows; ++row) {
+                append(row ? ",{\"row\":\"" : "{\"row\":\"");
+                append(row == 0               ? string("total")
+                       : row <= numComponents ? problem.componentNames[row - 1]
+                                              : "ratio:" + to_string(row - numComponents - 1));
+                append("\",\"rhs\":");
+                appendNumber(ranging.rhs[row]);
+                append(",\"low\":");
+                appendNumber(ranging.rhsLow[row]);
+                append(",\"high\":");
+                appendNumber(ranging.rhsHigh[row]);
+                append("}");
+            }
+            append("]}\n");
+            flushIfFull();
+            return;
+        }
+
+        append("\nCost Ranging (basis stays optimal):\n");
+        for (int i = 0; i < numFeeds; ++i) {
+            append("  Feed ");
+            append(problem.feedNames[i]);
+            append(": $");
+            appendNumber(problem.cost[i]);
+            append(" in [");
+            appendNumber(ranging.costLow[i]);
+            append(", ");
+            appendNumber(ranging.costHigh[i]);
+            append("]\n");
+        }
+        append("\nRight-Hand Side Ranging:\n");
+        for (int row = 0; row < numRows; ++row) {
+            append("  ");
+            append(rowName(row));
+            append(": ");
+            appendNumber(ranging.rhs[row]);
+            append(" in [");
+            appendNumber(ranging.rhsLow[row]);
+            append(", ");
+            appendNumber(ranging.rhsHigh[row]);
+            append("]\n");
+        }
+        flushIfFull();
+    }
+
+    // Hands the formatted output to the caller instead of writing it, for
+    // callers that write to non-blocking sockets themselves
+    void drainTo(string &out) {
+        out.append(buffer_);
+        buffer_.clear();
+    }
+
+    void flush() {
+        BLENDER_TIME_PHASE(PHASE_EXTRACT);
+        size_t written = 0;
+        while (written < buffer_.size()) {
+            ssize_t put = write(fd_, buffer_.data() + written, buffer_.size() - written);
+            if (put < 0 && errno == EINTR) {
+                continue;
+            }
+            if (put <= 0) {
+                break; // nowhere to report it; drop the rest like a closed pipe
+            }
+            written += put;
+        }
+        buffer_.clear();
+    }
+
+private:
+    void flushIfFull() {
+        if (buffer_.size() >= flushBytes_) {
+            flush();
+        }
+    }
+
+    void append(const char *text) { buffer_.append(text); }
+    void append(const string &text) { buffer_.append(text); }
+
+    void appendInteger(long value) {
+        char text[24];
+        char *end = to_chars(text, text + sizeof(text), value).ptr;
+        buffer_.append(text, end);
+    }
+
+    void appendNumber(double value) {
+        if (!isfinite(value) && format_ == OUTPUT_NDJSON) {
+            append("null");
+            return;
+        }
+        char text[64];
+        char *end = format_ == OUTPUT_NDJSON
+                        ? to_chars(text, text + sizeof(text), value).ptr
+                        : to_chars(text, text + sizeof(text), value, chars_format::general, 6).ptr;
+        buffer_.append(text, end);
+    }
+
+    void appendArray(const char *key, const double *values, int count) {
+        append(",\"");
+        append(key);
+        append("\":[");
+        for (int k = 0; k < count; ++k) {
+            if (k > 0) {
+                append(",");
+            }
+            appendNumber(values[k]);
+        }
+        append("]");
+    }
+
+    OutputFormat format_;
+    int fd_;
+    size_t flushBytes_;
+    string buffer_;
+};
+
+
+// --- 8. BATCH MODE: Re-optimize a stream of scenarios on one model ---
+
+// One scenario overrides the prices, the minimum specs and the blend size.
+// Input is one scenario per line, whitespace separated, in problem ID order:
+//   cost_0 .. cost_{numFeeds-1}  req_0 .. req_{numComponents-1}  total_blend
+// Blank lines and lines starting with '#' are skipped.
+struct Scenario {
+    vector<double> costs;   // one per feed ID
+    vector<double> reqMin;  // one per component ID
+    double totalBlend;
+};
+
+// What a scenario changed relative to the model it is applied to. This picks
+// the re-optimization algorithm: after a bound change the old basis is still
+// dual feasible (dual simplex), after a cost change it is still primal
+// feasible (primal simplex).
+enum ScenarioChange {
+    CHANGED_NOTHING = 0,
+    CHANGED_COSTS = 1,
+    CHANGED_BOUNDS = 2,
+    CHANGED_STRUCTURE = 4,  // columns added or removed (live model only)
+    CHANGED_COEFFICIENTS = 8  // matrix elements rewritten in place (successive LP)
+};
+
+// The scenario the problem was built with.
+Scenario baseScenario(const BlendProblem &problem) {
+    Scenario base;
+    base.costs = problem.cost;
+    base.reqMin = problem.reqMin;
+    base.totalBlend = problem.totalBlend;
+    return base;
+}
+
+// Reads the next scenario from the stream. Returns false at end of input;
+// malformed lines are reported and skipped.
+bool readScenario(istream &in, const BlendProblem &problem, Scenario &scenario, long &lineNumber) {
+    string line;
+    while (getline(in, line)) {
+        ++lineNumber;
+        size_t first = line.find_first_not_of(" \t\r");
+        if (first == string::npos || line[first] == '#') {
+            continue;
+        }
+
+        istringstream fields(line);
+        scenario.costs.resize(problem.numFeeds());
+        scenario.reqMin.resize(problem.numComponents());
+        bool ok = true;
+        for (int i = 0; ok && i < problem.numFeeds(); ++i) {
+            ok = static_cast<bool>(fields >> scenario.costs[i]);
+        }
+        for (int j = 0; ok && j < problem.numComponents(); ++j) {
+            ok = static_cast<bool>(fields >> scenario.reqMin[j]);
+        }
+        ok = ok && (fields >> scenario.totalBlend);
+        if (ok) {
+            return true;
+        }
+        cerr << "Skipping malformed scenario on line " << lineNumber << endl;
+    }
+    return false;
+}
+
+// Parses one scenario line (the readScenario format, nothing after the
+// fields) without going through a stream.
+bool parseScenarioLine(const char *begin, const char *end, const BlendProblem &problem,
+                       Scenario &scenario) {
+    scenario.costs.resize(problem.numFeeds());
+    scenario.reqMin.resize(problem.numComponents());
+    int numFields = problem.numFeeds() + problem.numComponents() + 1;
+    const char *p = begin;
+    for (int field = 0; field < numFields; ++field) {
+        while (p < end && (*p == ' ' || *p == '\t' || *p == '\r')) {
+            ++p;
+        }
+        const char *start = p;
+        while (p < end && *p != ' ' && *p != '\t' && *p != '\r') {
+            ++p;
+        }
+        double value;
+        if (start == p || !parseNumber(start, p, value)) {
+            return false;
+        }
+        if (field < problem.numFeeds()) {
+            scenario.costs[field] = value;
+        } else if (field < numFields - 1) {
+            scenario.reqMin[field - problem.numFeeds()] = value;
+        } else {
+            scenario.totalBlend = value;
+        }
+    }
+    while (p < end && (*p == ' ' || *p == '\t' || *p == '\r')) {
+        ++p;
+    }
+    return p == end;
+}
+
+// Patches the live model of `problem` from `current` to `next` and returns
+// what changed. Max specs and share-of-blend ratio limits are not part of a
+// scenario, but their rows scale with the total.
+int applyScenario(ClpSimplex &model, const BlendProblem &problem, const Scenario &current,
+                  const Scenario &next) {
+    int changed = CHANGED_NOTHING;
+
+    for (size_t i = 0; i < next.costs.size(); ++i) {
+        if (next.costs[i] != current.costs[i]) {
+            model.setObjectiveCoefficient(i, next.costs[i]);
+            changed |= CHANGED_COSTS;
+        }
+    }
+
+    // Row 0 is the total flow, row j + 1 is component j (see buildModel)
+    if (next.totalBlend != current.totalBlend) {
+        model.setRowBounds(0, next.totalBlend, next.totalBlend);
+        changed |= CHANGED_BOUNDS;
+    }
+    for (size_t j = 0; j < next.reqMin.size(); ++j) {
+        if (next.reqMin[j] != current.reqMin[j] || next.totalBlend != current.totalBlend) {
+            model.setRowBounds(j + 1, next.reqMin[j] * next.totalBlend,
+                               perBlend(problem.reqMax[j], next.totalBlend));
+            changed |= CHANGED_BOUNDS;
+        }
+    }
+    if (next.totalBlend != current.totalBlend && problem.numRatios() > 0) {
+        vector<RatioRow> rows;
+        ratioRows(problem.view(), rows);
+        for (size_t r = 0; r < rows.size(); ++r) {
+            if (rows[r].share) {
+                model.setRowBounds(problem.numComponents() + 1 + r,
+                                   perBlend(rows[r].lower, next.totalBlend),
+                                   perBlend(rows[r].upper, next.totalBlend));
+            }
+        }
+    }
+    return changed;
+}
+
+// Applies one stall remedy to `model`. Remedies stay with the model, so a
+// batch model that stalled once starts its next scenarios with them.
+void applyStallRemedy(ClpSimplex &model, StallRemedy remedy, bool primal) {
+    switch (remedy) {
+    case REMEDY_PERTURB:
+        model.setPerturbation(50);
+        break;
+    case REMEDY_PRICING:
+        if (primal) {
+            ClpPrimalColumnSteepest devex(0);
+            model.setPrimalColumnPivotAlgorithm(devex);
+        } else {
+            ClpDualRowSteepest steepest(1);
+            model.setDualRowPivotAlgorithm(steepest);
+        }
+        break;
+    default:
+        model.scaling(model.scalingFlag() == 2 ? 1 : 2);
+        break;
+    }
+}
+
+// Runs the primal (or dual) simplex from the basis in `model`. Each time the
+// stall monitor stops it (solveOptions.stallIterations iterations without
+// progress), the next StallRemedy is applied and the solve goes on from
+// where it stopped; a stall after the last remedy is left to run its course
+// unwatched. Models without a CountingEventHandler are never stopped.
+void runSimplex(ClpSimplex &model, bool primal, int valuesPass = 0) {
+    CountingEventHandler *monitor = dynamic_cast<CountingEventHandler *>(model.eventHandler());
+    int iterations = 0;
+    for (int remedy = 0;; ++remedy) {
+        if (monitor) {
+            monitor->watch(remedy <= NUM_STALL_REMEDIES ? solveOptions.stallIterations : 0);
+        }
+        if (primal) {
+            model.primal(valuesPass);
+        } else {
+            model.dual();
+        }
+        iterations += model.numberIterations();
+        if (!monitor || !monitor->stalled()) {
+            if (remedy > 0 && remedy <= NUM_STALL_REMEDIES) {
+                solverStats.stallRemedySuccesses[remedy - 1].fetch_add(1, memory_order_relaxed);
+            }
+            break;
+        }
+        if (remedy == NUM_STALL_REMEDIES) {
+            solverStats.stallsUnresolved.fetch_add(1, memory_order_relaxed);
+            continue;
+        }
+        applyStallRemedy(model, static_cast<StallRemedy>(remedy), primal);
+        solverStats.stallRemedies[remedy].fetch_add(1, memory_order_relaxed);
+        valuesPass = 0;
+    }
+    if (monitor) {
+        monitor->watch(0);
+    }
+    model.setNumberIterations(iterations);
+}
+
+// Re-optimizes after applyScenario, starting from the basis left in the model.
+void warmSolve(ClpSimplex &model, int changed) {
+    if (changed == CHANGED_NOTHING) {
+        return;
+    }
+    {
+        BLENDER_TIME_PHASE(PHASE_SIMPLEX);
+        if ((changed & CHANGED_BOUNDS) && !(changed & CHANGED_STRUCTURE)) {
+            // Dual simplex copes with the cost change too (the dual infeasibilities
+            // are cleaned up by its final primal pass)
+            runSimplex(model, false);
+        } else {
+            // Costs changed or columns came and went: the primal simplex
+            // starts from whatever the old basis still offers
+            runSimplex(model, true);
+        }
+    }
+    recordSolve(model);
+}
+
+// Models below this many rows plus columns always get the dual simplex
+const long BARRIER_MIN_SIZE = 100000;
+// ... and so do models with a column spanning more than this fraction of the
+// rows (a dense column makes A D A^T, which the barrier factors, dense)
+const double BARRIER_MAX_COLUMN_FRACTION = 0.05;
+// With the GPU backend, models with this many matrix elements go to PDLP
+const long PDLP_MIN_ELEMENTS = 10000000;
+
+// Picks the algorithm for a cold solve of `model` and records the choice.
+// Unless solveOptions.algorithm fixes it: dual simplex, whose iteration
+// count grows with the row count, until the model is big enough for the
+// barrier's few (tens of) Cholesky factorizations to win, as long as A D A^T
+// stays sparse; in BLENDER_WITH_CUDA builds PDLP once even the barrier's
+// factorizations get too big. The primal simplex is only used when asked for.
+Algorithm chooseAlgorithm(const ClpSimplex &model) {
+    Algorithm algorithm = solveOptions.algorithm;
+    bool automatic = algorithm == ALGORITHM_AUTO;
+    if (automatic) {
+        algorithm = ALGORITHM_DUAL;
+        long size = static_cast<long>(model.numberRows()) + model.numberColumns();
+        if (size >= BARRIER_MIN_SIZE) {
+            const int *lengths = model.matrix()->getVectorLengths();
+            int longest = 0;
+            for (int column = 0; column < model.numberColumns(); ++column) {
+                longest = max(longest, lengths[column]);
+            }
+            if (longest <= BARRIER_MAX_COLUMN_FRACTION * model.numberRows()) {
+                algorithm = ALGORITHM_BARRIER;
+            }
+        }
+#if BLENDER_WITH_CUDA
+        if (model.matrix()->getNumElements() >= PDLP_MIN_ELEMENTS) {
+            algorithm = ALGORITHM_PDLP;
+        }
+#endif
+    }
+    solverStats.algorithmChoices[algorithm][automatic].fetch_add(1, memory_order_relaxed);
+    solverStats.lastAlgorithm.store(algorithm, memory_order_relaxed);
+    return algorithm;
+}
+
+// The Cholesky factorization for the barrier: MKL PARDISO (multithreaded)
+// in -DBLENDER_WITH_PARDISO=1 builds, CLP's native one otherwise.
+// ClpInterior takes ownership.
+ClpCholeskyBase *makeCholesky() {
+#if BLENDER_WITH_PARDISO
+    int threads = solveOptions.barrierThreads > 0 ? solveOptions.barrierThreads
+                                                   : max(1u, thread::hardware_concurrency());
+    mkl_set_num_threads(threads);
+    return new ClpCholeskyPardiso();
+#else
+    return new ClpCholeskyBase();
+#endif
+}
+
+// Interior point to near-optimality, then a primal values pass as the
+// crossover to an optimal basis (which postsolve and warm starts need).
+void barrierSolve(ClpSimplex &model) {
+    int iterations;
+    {
+        BLENDER_TIME_PHASE(PHASE_BARRIER);
+        ClpInterior barrier;
+        barrier.borrowModel(model);
+        barrier.setCholesky(makeCholesky());
+        barrier.primalDual();
+        iterations = barrier.numberIterations();
+        barrier.returnModel(model);
+    }
+    {
+        BLENDER_TIME_PHASE(PHASE_SIMPLEX);
+        runSimplex(model, true, 1);
+    }
+    model.setNumberIterations(iterations + model.numberIterations());
+}
+
+#if BLENDER_WITH_CUDA
+// PDLP: restarted primal-dual hybrid gradient on the GPU, for models too big
+// for a timely barrier. It works on ClpSimplex's own column-major copy of
+// the builder's matrix (also uploaded row-major, so both products are plain
+// CSR SpMVs), Ruiz-equilibrated on the host first. Each iteration is
+//   x+ = proj[l, u](x - tau (c + A'y)),   y+ = v - sigma proj[rl, ru](v / sigma)
+// with v = y + sigma A (2 x+ - x), i.e. two SpMVs and two elementwise
+// kernels. Every PDLP_CHECK_PERIOD iterations the current and the average
+// iterate are copied to the host and their relative KKT error (primal
+// residual, dual residual, duality gap) is worked out; every
+// PDLP_RESTART_PERIOD iterations the better of the two becomes the restart
+// point and the primal weight is rebalanced. At PDLP_TOLERANCE the point
+// goes to the ClpSimplex crossover (a primal values pass), like a barrier
+// solution does.
+const double PDLP_TOLERANCE = 1.0e-4;
+const int PDLP_MAX_ITERATIONS = 100000;
+const int PDLP_CHECK_PERIOD = 64;
+const int PDLP_RESTART_PERIOD = 1024;
+const int PDLP_RUIZ_PASSES = 10;
+const int PDLP_POWER_ITERATIONS = 32;
+const int PDLP_BLOCK_SIZE = 256;
+
+__global__ void pdlpPrimalStep(int n, double tau, const double *cost, const double *aty,
+                               const double *lower, const double *upper, double *x, double *xBar,
+                               double *xSum) {
+    int i = blockIdx.x * blockDim.x + threadIdx.x;
+    if (i < n) {
+        double old = x[i];
+        double next = fmin(fmax(old - tau * (cost[i] + aty[i]), lower[i]), upper[i]);
+        x[i] = next;
+        xBar[i] = 2.0 * next - old;
+        xSum[i] += next;
+    }
+}
+
+__global__ void pdlpDualStep(int m, double sigma, const double *axBar, const double *rowLower,
+                             const double *rowUpper, double *y, double *ySum) {
+    int j = blockIdx.x * blockDim.x + threadIdx.x;
+    if (j < m) {
+        double v = y[j] + sigma * axBar[j];
+        double next = v - sigma * fmin(fmax(v / sigma, rowLower[j]), rowUpper[j]);
+        y[j] = next;
+        ySum[j] += next;
+    }
+}
+
+// The device side of one PDLP solve; everything is released with it
+class PdlpDevice {
+public:
+    PdlpDevice(const PdlpDevice &) = delete;
+    PdlpDevice &operator=(const PdlpDevice &) = delete;
+    PdlpDevice() = default;
+    ~PdlpDevice() {
+        for (void *array : arrays_) {
+            cudaFree(array);
+        }
+        if (a_) {
+            cusparseDestroySpMat(a_);
+        }
+        if (at_) {
+            cusparseDestroySpMat(at_);
+        }
+        if (sparse_) {
+            cusparseDestroy(sparse_);
+        }
+        if (blas_) {
+            cublasDestroy(blas_);
+        }
+    }
+
+    bool ok() const { return error_.empty(); }
+    const string &error() const { return error_; }
+
+    // A device copy of `size` elements of `host` (zeros when null)
+    template <class T>
+    T *upload(const T *host, size_t size) {
+        void *array = nullptr;
+        if (!check(cudaMalloc(&array, max<size_t>(size, 1) * sizeof(T)) == cudaSuccess,
+                   "cudaMalloc")) {
+            return nullptr;
+        }
+        arrays_.push_back(array);
+        check(host ? cudaMemcpy(array, host, size * sizeof(T), cudaMemcpyHostToDevice) ==
+                         cudaSuccess
+                   : cudaMemset(array, 0, size * sizeof(T)) == cudaSuccess,
+              "cudaMemcpy");
+        return static_cast<T *>(array);
+    }
+
+    void download(double *host, const double *array, size_t size) {
+        check(cudaMemcpy(host, array, size * sizeof(double), cudaMemcpyDeviceToHost) == cudaSuccess,
+              "cudaMemcpy");
+    }
+
+    void copy(double *to, const double *from, size_t size) {
+        check(cudaMemcpy(to, from, size * sizeof(double), cudaMemcpyDeviceToDevice) == cudaSuccess,
+              "cudaMemcpy");
+    }
+
+    void clear(double *array, size_t size) {
+        check(cudaMemset(array, 0, size * sizeof(double)) == cudaSuccess, "cudaMemset");
+    }
+
+    // The m x n matrix A from its column starts (CSR of A') and row starts
+    void setMatrix(int m, int n, int numElements, const int *columnStarts, const int *rowIndices,
+                   const double *columnElements, const int *rowStarts, const int *columnIndices,
+                   const double *rowElements) {
+        numRows_ = m;
+        numColumns_ = n;
+        int *dColumnStarts = upload(columnStarts, n + 1);
+        int *dRowIndices = upload(rowIndices, numElements);
+        double *dColumnElements = upload(columnElements, numElements);
+        int *dRowStarts = upload(rowStarts, m + 1);
+        int *dColumnIndices = upload(columnIndices, numElements);
+        double *dRowElements = upload(rowElements, numElements);
+        if (!ok() ||
+            !check(cusparseCreate(&sparse_) == CUSPARSE_STATUS_SUCCESS, "cusparseCreate") ||
+            !check(cublasCreate(&blas_) == CUBLAS_STATUS_SUCCESS, "cublasCreate")) {
+            return;
+        }
+        check(cusparseCreateCsr(&at_, n, m, numElements, dColumnStarts, dRowIndices,
+                                dColumnElements, CUSPARSE_INDEX_32I, CUSPARSE_INDEX_32I,
+                                CUSPARSE_INDEX_BASE_ZERO, CUDA_R_64F) == CUSPARSE_STATUS_SUCCESS &&
+                  cusparseCreateCsr(&a_, m, n, numElements, dRowStarts, dColumnIndices,
+                                    dRowElements, CUSPARSE_INDEX_32I, CUSPARSE_INDEX_32I,
+                                    CUSPARSE_INDEX_BASE_ZERO,
+                                    CUDA_R_64F) == CUSPARSE_STATUS_SUCCESS,
+              "cusparseCreateCsr");
+    }
+
+    // out = A in (transposed: out = A' in)
+    void multiply(bool transposed, const double *in, double *out) {
+        if (!ok()) {
+            return;
+        }
+        int inSize = transposed ? numRows_ : numColumns_;
+        int outSize = transposed ? numColumns_ : numRows_;
+        cusparseSpMatDescr_t matrix = transposed ? at_ : a_;
+        cusparseDnVecDescr_t vectorIn, vectorOut;
+        cusparseCreateDnVec(&vectorIn, inSize, const_cast<double *>(in), CUDA_R_64F);
+        cusparseCreateDnVec(&vectorOut, outSize, out, CUDA_R_64F);
+        double one = 1.0, zero = 0.0;
+        size_t bytes = 0;
+        bool done = cusparseSpMV_bufferSize(sparse_, CUSPARSE_OPERATION_NON_TRANSPOSE, &one,
+                                            matrix, vectorIn, &zero, vectorOut, CUDA_R_64F,
+                                            CUSPARSE_SPMV_ALG_DEFAULT,
+                                            &bytes) == CUSPARSE_STATUS_SUCCESS;
+        if (done && bytes > bufferBytes_) {
+            bufferBytes_ = bytes;
+            buffer_ = upload<char>(nullptr, bytes);
+            done = ok();
+        }
+        done = done && cusparseSpMV(sparse_, CUSPARSE_OPERATION_NON_TRANSPOSE, &one, matrix,
+                                    vectorIn, &zero, vectorOut, CUDA_R_64F,
+                                    CUSPARSE_SPMV_ALG_DEFAULT, buffer_) == CUSPARSE_STATUS_SUCCESS;
+        cusparseDestroyDnVec(vectorIn);
+        cusparseDestroyDnVec(vectorOut);
+        check(done, "cusparseSpMV");
+    }
+
+    // to = from * scale
+    void scaled(double *to, const double *from, int size, double scale) {
+        copy(to, from, size);
+        check(cublasDscal(blas_, size, &scale, to, 1) == CUBLAS_STATUS_SUCCESS, "cublasDscal");
+    }
+
+    double norm(const double *array, int size) {
+        double result = 0.0;
+        check(cublasDnrm2(blas_, size, array, 1, &result) == CUBLAS_STATUS_SUCCESS, "cublasDnrm2");
+        return result;
+    }
+
+    void launched() {
+        check(cudaGetLastError() == cudaSuccess, "kernel launch");
+    }
+
+private:
+    bool check(bool success, const char *what) {
+        if (!success && error_.empty()) {
+            error_ = string(what) + " failed";
+        }
+        return success && error_.empty();
+    }
+
+    vector<void *> arrays_;
+    cusparseHandle_t sparse_ = nullptr;
+    cublasHandle_t blas_ = nullptr;
+    cusparseSpMatDescr_t a_ = nullptr, at_ = nullptr;
+    char *buffer_ = nullptr;
+    size_t bufferBytes_ = 0;
+    int numRows_ = 0, numColumns_ = 0;
+    string error_;
+};
+
+// The scaled problem PDLP works on, on the host; infinite bounds are +-inf
+struct PdlpProblem {
+    int numRows, numColumns;
+    vector<double> cost, lower, upper, rowLower, rowUpper;
+    vector<double> columnScale, rowScale;  // x = columnScale x^, y = rowScale y^
+    double costNorm = 0.0, boundNorm = 0.0;
+};
+
+// Relative KKT error of (x, y) given ax = A x and aty = A'y, in the PDHG
+// sign convention (reduced costs c + A'y)
+double pdlpError(const PdlpProblem &p, const vector<double> &x, const vector<double> &y,
+                 const vector<double> &ax, const vector<double> &aty) {
+    double primal = 0.0, dual = 0.0, primalObjective = 0.0, dualObjective = 0.0;
+    // A dual value wants the finite bound on its side; without one it is a residual
+    auto side = [&](double value, double low, double high) {
+        double bound = value > 0.0 ? low : high;
+        if (value == 0.0) {
+            return;
+        }
+        if (isfinite(bound)) {
+            dualObjective += value * bound;
+        } else {
+            dual += value * value;
+        }
+    };
+    for (int j = 0; j < p.numRows; ++j) {
+        double violation = ax[j] - min(max(ax[j], p.rowLower[j]), p.rowUpper[j]);
+        primal += violation * violation;
+        side(-y[j], p.rowLower[j], p.rowUpper[j]);
+    }
+    for (int i = 0; i < p.numColumns; ++i) {
+        primalObjective += p.cost[i] * x[i];
+        side(p.cost[i] + aty[i], p.lower[i], p.upper[i]);
+    }
+    double gap = fabs(primalObjective - dualObjective) /
+                 (1.0 + fabs(primalObjective) + fabs(dualObjective));
+    return max({sqrt(primal) / (1.0 + p.boundNorm), sqrt(dual) / (1.0 + p.costNorm), gap});
+}
+
+// Runs PDHG on `model` and leaves the point it reached as the model's primal
+// and dual solution; false (with the reason) if the GPU could not be used
+bool pdlpIterate(ClpSimplex &model, int &iterations, string &error) {
+    int m = model.numberRows();
+    int n = model.numberColumns();
+    const CoinPackedMatrix *matrix = model.matrix();
+    const CoinBigIndex *starts = matrix->getVectorStarts();
+    const int *lengths = matrix->getVectorLengths();
+    const int *indices = matrix->getIndices();
+    const double *elements = matrix->getElements();
+
+    // Compact column-major copy
+    vector<int> columnStarts(n + 1, 0), rowIndices;
+    vector<double> columnElements;
+    for (int i = 0; i < n; ++i) {
+        for (CoinBigIndex k = starts[i]; k < starts[i] + lengths[i]; ++k) {
+            rowIndices.push_back(indices[k]);
+            columnElements.push_back(elements[k]);
+        }
+        columnStarts[i + 1] = rowIndices.size();
+    }
+    int numElements = rowIndices.size();
+
+    // Ruiz equilibration: rows and columns scaled towards unit max norm
+    PdlpProblem p;
+    p.numRows = m;
+    p.numColumns = n;
+    p.columnScale.assign(n, 1.0);
+    p.rowScale.assign(m, 1.0);
+    for (int pass = 0; pass < PDLP_RUIZ_PASSES; ++pass) {
+        vector<double> rowMax(m, 0.0), columnMax(n, 0.0);
+        for (int i = 0; i < n; ++i) {
+            for (int k = columnStarts[i]; k < columnStarts[i + 1]; ++k) {
+                double value = fabs(columnElements[k]);
+                columnMax[i] = max(columnMax[i], value);
+                rowMax[rowIndices[k]] = max(rowMax[rowIndices[k]], value);
+            }
+        }
+        for (int i = 0; i < n; ++i) {
+            double scale = columnMax[i] > 0.0 ? 1.0 / sqrt(columnMax[i]) : 1.0;
+            p.columnScale[i] *= scale;
+            for (int k = columnStarts[i]; k < columnStarts[i + 1]; ++k) {
+                columnElements[k] *= scale;
+            }
+        }
+        for (int k = 0; k < numElements; ++k) {
+            double value = rowMax[rowIndices[k]];
+            columnElements[k] /= value > 0.0 ? sqrt(value) : 1.0;
+        }
+        for (int j = 0; j < m; ++j) {
+            p.rowScale[j] /= rowMax[j] > 0.0 ? sqrt(rowMax[j]) : 1.0;
+        }
+    }
+
+    // Row-major copy for A x
+    vector<int> rowStarts(m + 1, 0), columnIndices(numElements);
+    vector<double> rowElements(numElements);
+    for (int k = 0; k < numElements; ++k) {
+        ++rowStarts[rowIndices[k] + 1];
+    }
+    for (int j = 0; j < m; ++j) {
+        rowStarts[j + 1] += rowStarts[j];
+    }
+    vector<int> fill(rowStarts.begin(), rowStarts.end() - 1);
+    for (int i = 0; i < n; ++i) {
+        for (int k = columnStarts[i]; k < columnStarts[i + 1]; ++k) {
+            int at = fill[rowIndices[k]]++;
+            columnIndices[at] = i;
+            rowElements[at] = columnElements[k];
+        }
+    }
+
+    auto bound = [](double value, double scale) {
+        return fabs(value) >= 1.0e+20 ? copysign(INFINITY, value) : value * scale;
+    };
+    const double *cost = model.getObjCoefficients();
+    for (int i = 0; i < n; ++i) {
+        p.cost.push_back(cost[i] * p.columnScale[i]);
+        p.lower.push_back(bound(model.getColLower()[i], 1.0 / p.columnScale[i]));
+        p.upper.push_back(bound(model.getColUpper()[i], 1.0 / p.columnScale[i]));
+        p.costNorm += p.cost[i] * p.cost[i];
+    }
+    for (int j = 0; j < m; ++j) {
+        p.rowLower.push_back(bound(model.getRowLower()[j], p.rowScale[j]));
+        p.rowUpper.push_back(bound(model.getRowUpper()[j], p.rowScale[j]));
+        for (double b : {p.rowLower[j], p.rowUpper[j]}) {
+            p.boundNorm += isfinite(b) ? b * b : 0.0;
+        }
+    }
+    p.costNorm = sqrt(p.costNorm);
+    p.boundNorm = sqrt(p.boundNorm);
+
+    PdlpDevice device;
+    device.setMatrix(m, n, numElements, columnStarts.data(), rowIndices.data(),
+                     columnElements.data(), rowStarts.data(), columnIndices.data(),
+                     rowElements.data());
+    vector<double> start(n);
+    for (int i = 0; i < n; ++i) {
+        start[i] = min(max(0.0, p.lower[i]), p.upper[i]);
+    }
+    double *dCost = device.upload(p.cost.data(), n);
+    double *dLower = device.upload(p.lower.data(), n);
+    double *dUpper = device.upload(p.upper.data(), n);
+    double *dRowLower = device.upload(p.rowLower.data(), m);
+    double *dRowUpper = device.upload(p.rowUpper.data(), m);
+    double *x = device.upload(start.data(), n);
+    double *xBar = device.upload<double>(nullptr, n);
+    double *xSum = device.upload<double>(nullptr, n);
+    double *xAverage = device.upload<double>(nullptr, n);
+    double *y = device.upload<double>(nullptr, m);
+    double *ySum = device.upload<double>(nullptr, m);
+    double *yAverage = device.upload<double>(nullptr, m);
+    double *ax = device.upload<double>(nullptr, m);
+    double *aty = device.upload<double>(nullptr, n);
+    double *atyAverage = device.upload<double>(nullptr, n);
+    if (!device.ok()) {
+        error = device.error();
+        return false;
+    }
+
+    // ||A|| by power iteration on A'A
+    double *power = device.upload(vector<double>(n, 1.0).data(), n);
+    double normA = 1.0;
+    for (int k = 0; k < PDLP_POWER_ITERATIONS && device.ok(); ++k) {
+        device.multiply(false, power, ax);
+        device.multiply(true, ax, power);
+        double norm = device.norm(power, n);
+        if (norm <= 0.0) {
+            break;
+        }
+        normA = sqrt(norm);
+        device.scaled(power, power, n, 1.0 / norm);
+    }
+
+    double step = 0.9 / normA;
+    double weight = p.costNorm > 0.0 && p.boundNorm > 0.0 ? p.costNorm / p.boundNorm : 1.0;
+    int blocksN = (n + PDLP_BLOCK_SIZE - 1) / PDLP_BLOCK_SIZE;
+    int blocksM = (m + PDLP_BLOCK_SIZE - 1) / PDLP_BLOCK_SIZE;
+    int averaged = 0;
+    vector<double> hostX(n), hostY(m), hostAx(m), hostAty(n);
+    vector<double> bestX(start), bestY(m, 0.0), restartX(start), restartY(m, 0.0);
+    double bestError = INFINITY;
+    device.multiply(true, y, aty);
+
+    for (iterations = 1; iterations <= PDLP_MAX_ITERATIONS && device.ok(); ++iterations) {
+        double tau = step / weight;
+        double sigma = step * weight;
+        pdlpPrimalStep<<<blocksN, PDLP_BLOCK_SIZE>>>(n, tau, dCost, aty, dLower, dUpper, x, xBar,
+                                                     xSum);
+        device.launched();
+        device.multiply(false, xBar, ax);
+        pdlpDualStep<<<blocksM, PDLP_BLOCK_SIZE>>>(m, sigma, ax, dRowLower, dRowUpper, y, ySum);
+        device.launched();
+        device.multiply(true, y, aty);
+        ++averaged;
+        if (iterations % PDLP_CHECK_PERIOD != 0) {
+            continue;
+        }
+
+        // The current iterate ...
+        device.multiply(false, x, ax);
+        device.download(hostX.data(), x, n);
+        device.download(hostY.data(), y, m);
+        device.download(hostAx.data(), ax, m);
+        device.download(hostAty.data(), aty, n);
+        double currentError = pdlpError(p, hostX, hostY, hostAx, hostAty);
+        if (currentError < bestError) {
+            bestError = currentError;
+            bestX = hostX;
+            bestY = hostY;
+        }
+        // ... and the average since the last restart
+        device.scaled(xAverage, xSum, n, 1.0 / averaged);
+        device.scaled(yAverage, ySum, m, 1.0 / averaged);
+        device.multiply(false, xAverage, ax);
+        device.multiply(true, yAverage, atyAverage);
+        vector<double> averageX(n), averageY(m);
+        device.download(averageX.data(), xAverage, n);
+        device.download(averageY.data(), yAverage, m);
+        device.download(hostAx.data(), ax, m);
+        device.download(hostAty.data(), atyAverage, n);
+        double averageError = pdlpError(p, averageX, averageY, hostAx, hostAty);
+        if (averageError < bestError) {
+            bestError = averageError;
+            bestX = averageX;
+            bestY = averageY;
+        }
+        if (bestError <= PDLP_TOLERANCE) {
+            break;
+        }
+        if (iterations % PDLP_RESTART_PERIOD != 0) {
+            continue;
+        }
+
+        // Restart from the better point, with the primal weight moved
+        // halfway (in log terms) towards the ratio of the dual and primal
+        // distances travelled since the last restart
+        if (averageError < currentError) {
+            device.copy(x, xAverage, n);
+            device.copy(y, yAverage, m);
+            device.copy(aty, atyAverage, n);
+            hostX.swap(averageX);
+            hostY.swap(averageY);
+        }
+        double primalMove = 0.0, dualMove = 0.0;
+        for (int i = 0; i < n; ++i) {
+            primalMove += (hostX[i] - restartX[i]) * (hostX[i] - restartX[i]);
+        }
+        for (int j = 0; j < m; ++j) {
+            dualMove += (hostY[j] - restartY[j]) * (hostY[j] - restartY[j]);
+        }
+        if (primalMove > 1.0e-20 && dualMove > 1.0e-20) {
+            weight = exp(0.5 * log(sqrt(dualMove / primalMove)) + 0.5 * log(weight));
+        }
+        restartX = hostX;
+        restartY = hostY;
+        device.clear(xSum, n);
+        device.clear(ySum, m);
+        averaged = 0;
+    }
+    if (!device.ok()) {
+        error = device.error();
+        return false;
+    }
+    iterations = min(iterations, PDLP_MAX_ITERATIONS);
+
+    // Back to the model's scaling and CLP's dual sign
+    double *columnSolution = model.primalColumnSolution();
+    for (int i = 0; i < n; ++i) {
+        columnSolution[i] = bestX[i] * p.columnScale[i];
+    }
+    double *rowDuals = model.dualRowSolution();
+    for (int j = 0; j < m; ++j) {
+        rowDuals[j] = -bestY[j] * p.rowScale[j];
+    }
+    return true;
+}
+
+// PDHG to PDLP_TOLERANCE, then a primal values pass as the crossover. If the
+// GPU fails, the dual simplex solves the model instead.
+void pdlpSolve(ClpSimplex &model) {
+    int iterations = 0;
+    string error;
+    bool done;
+    {
+        BLENDER_TIME_PHASE(PHASE_PDLP);
+        done = pdlpIterate(model, iterations, error);
+    }
+    BLENDER_TIME_PHASE(PHASE_SIMPLEX);
+    if (!done) {
+        cerr << "PDLP failed (" << error << "), using the dual simplex" << endl;
+        runSimplex(model, false);
+        return;
+    }
+    model.allSlackBasis(false);
+    runSimplex(model, true, 1);
+    model.setNumberIterations(iterations + model.numberIterations());
+}
+#endif
+
+void runAlgorithm(ClpSimplex &model, Algorithm algorithm) {
+    if (algorithm == ALGORITHM_BARRIER) {
+        barrierSolve(model);
+        return;
+    }
+#if BLENDER_WITH_CUDA
+    if (algorithm == ALGORITHM_PDLP) {
+        pdlpSolve(model);
+        return;
+    }
+#endif
+    BLENDER_TIME_PHASE(PHASE_SIMPLEX);
+    runSimplex(model, algorithm == ALGORITHM_PRIMAL);
+}
+
+// Presolves `model` when solveOptions.presolve is set and counts the
+// reductions. Null when presolve is off or found the problem infeasible or
+// unbounded.
+ClpSimplex *presolveModel(ClpSimplex &model, ClpPresolve &presolve) {
+    if (!solveOptions.presolve) {
+        return nullptr;
+    }
+    ClpSimplex *reduced;
+    {
+        BLENDER_TIME_PHASE(PHASE_PRESOLVE);
+        reduced = presolve.presolvedModel(model, 1.0e-8);
+    }
+    if (reduced) {
+        solverStats.presolveRowsRemoved.fetch_add(model.numberRows() - reduced->numberRows(),
+                                                  memory_order_relaxed);
+        solverStats.presolveColumnsRemoved.fetch_add(
+            model.numberColumns() - reduced->numberColumns(), memory_order_relaxed);
+    }
+    return reduced;
+}
+
+// Restores the solution of `reduced` into `model` (and deletes it), with a
+// primal cleanup if the restored solution is not optimal
+void postsolveModel(ClpSimplex &model, ClpPresolve &presolve, ClpSimplex *reduced) {
+    BLENDER_TIME_PHASE(PHASE_SIMPLEX);
+    int iterations = reduced->numberIterations();
+    presolve.postsolve(true);
+    delete reduced;
+
+    model.checkSolution();
+    if (!model.isProvenOptimal()) {
+        runSimplex(model, true, 1);
+        iterations += model.numberIterations();
+    }
+    model.setNumberIterations(iterations);
+}
+
+// Presolve found the problem infeasible or unbounded; let the dual simplex
+// classify it on the original model
+void classifySolve(ClpSimplex &model) {
+    BLENDER_TIME_PHASE(PHASE_SIMPLEX);
+    ClpSolve options;
+    options.setPresolveType(ClpSolve::presolveOff);
+    model.initialSolve(options);
+}
+
+// Solves from scratch: presolve, the chosen algorithm on the reduced model,
+// postsolve and a primal cleanup if the restored solution needs one. This is
+// what initialSolve() does by default, spelled out so each step can be timed
+// and the presolve reductions counted.
+void coldSolve(ClpSimplex &model) {
+    Algorithm algorithm = chooseAlgorithm(model);
+    ClpPresolve presolve;
+    ClpSimplex *reduced = presolveModel(model, presolve);
+    if (reduced) {
+        runAlgorithm(*reduced, algorithm);
+        postsolveModel(model, presolve, reduced);
+    } else if (solveOptions.presolve) {
+        classifySolve(model);
+    } else {
+        runAlgorithm(model, algorithm);
+    }
+    recordSolve(model);
+}
+
+// Stops a racer at its next iteration once another one has won. The
+// interior point iterations of the barrier do not report events, so a
+// losing barrier racer runs on until its crossover starts.
+class RaceEventHandler : public CountingEventHandler {
+public:
+    explicit RaceEventHandler(const atomic<int> *winner) : winner_(winner) {}
+
+    int event(Event whichEvent) override {
+        int stop = CountingEventHandler::event(whichEvent);
+        if (stop >= 0) {
+            return stop;
+        }
+        if (whichEvent == endOfIteration && winner_->load(memory_order_relaxed) >= 0) {
+            return 5; // stop: status 5, "stopped by event handler"
+        }
+        return -1;
+    }
+    ClpEventHandler *clone() const override { return new RaceEventHandler(*this); }
+
+private:
+    const atomic<int> *winner_;
+};
+
+// Solves like coldSolve(), but on up to `numRacers` copies of the presolved
+// model at once, one per entry of RACE_VARIANTS (the barrier only on models
+// the chooser would consider it for), each on its own thread. The first
+// racer to prove optimality wins and the others are stopped at their next
+// iteration; the winner's solution and basis go back into the model. If
+// nobody proves optimality, the dual racer's verdict is kept.
+void raceSolve(ClpSimplex &model, int numRacers) {
+    ClpPresolve presolve;
+    ClpSimplex *reduced = presolveModel(model, presolve);
+    if (!reduced && solveOptions.presolve) {
+        classifySolve(model);
+        recordSolve(model);
+        return;
+    }
+    ClpSimplex &target = reduced ? *reduced : model;
+
+    bool barrierWorthIt =
+        static_cast<long>(target.numberRows()) + target.numberColumns() >= BARRIER_MIN_SIZE;
+    vector<int> variants;
+    for (int v = 0; v < NUM_RACE_VARIANTS && static_cast<int>(variants.size()) < numRacers; ++v) {
+        if (RACE_VARIANTS[v].algorithm != ALGORITHM_BARRIER || barrierWorthIt) {
+            variants.push_back(v);
+        }
+    }
+
+    atomic<int> winner{-1};
+    RaceEventHandler handler(&winner);
+    vector<unique_ptr<ClpSimplex>> racers;
+    for (int v : variants) {
+        racers.emplace_back(new ClpSimplex(target));
+        racers.back()->passInEventHandler(&handler);
+        if (RACE_VARIANTS[v].scaling >= 0) {
+            racers.back()->scaling(RACE_VARIANTS[v].scaling);
+        }
+    }
+    vector<thread> threads;
+    for (size_t k = 0; k < racers.size(); ++k) {
+        threads.emplace_back([&, k]() {
+            runAlgorithm(*racers[k], RACE_VARIANTS[variants[k]].algorithm);
+            if (racers[k]->isProvenOptimal()) {
+                int none = -1;
+                winner.compare_exchange_strong(none, static_cast<int>(k));
+            }
+        });
+    }
+    for (thread &t : threads) {
+        t.join();
+    }
+
+    int won = winner.load();
+    if (won >= 0) {
+        solverStats.raceWins[variants[won]].fetch_add(1, memory_order_relaxed);
+    }
+    target = *racers[won >= 0 ? won : 0];
+    CountingEventHandler counter;
+    target.passInEventHandler(&counter);
+
+    if (reduced) {
+        postsolveModel(model, presolve, reduced);
+    }
+    recordSolve(model);
+}
+
+// --- 8b. PRESOLVE CACHE: One presolve shared by all scenarios ---
+
+// Scenarios only move costs and row bounds, so the matrix structure presolve
+// works on never changes. The cache presolves the base model once, keeps the
+// reduced model (with its own warm basis) and the postsolve information, and
+// solves each scenario by patching the reduced model instead of presolving
+// again.
+//
+// That is only valid for data presolve left alone: a scenario that changes
+// the cost of a column presolve removed or rewrote (e.g. folded another
+// column's cost into), or the bounds of such a row, is not covered(), and
+// the caller presolves again around that scenario. Reductions that merely
+// depended on the old values (a column fixed because of its cost sign, a
+// row dropped as redundant under the old bounds) can make the postsolved
+// solution non-optimal or infeasible on the original model; a primal pass
+// from the postsolved basis then finishes the job, and if even that does not
+// prove the original model optimal the scenario is refused. What is returned
+// is therefore always an optimal solve of the original model. With
+// solveOptions.checkPresolveCache set, each cached solve is also compared
+// with a fresh one and refused when they disagree.
+class PresolveCache {
+public:
+    PresolveCache() = default;
+    PresolveCache(const PresolveCache &) = delete;
+    PresolveCache &operator=(const PresolveCache &) = delete;
+
+    // Presolves `model`, which holds `problem` as described by `base`. The
+    // model and the problem must outlive the cache; postsolve writes into
+    // the model.
+    bool build(ClpSimplex &model, const BlendProblem &problem, const Scenario &base) {
+        problem_ = &problem;
+        ratioRows(problem.view(), ratioRows_);
+        {
+            BLENDER_TIME_PHASE(PHASE_PRESOLVE);
+            reduced_.reset(presolve_.presolvedModel(model, 1.0e-8));
+        }
+        if (!reduced_) {
+            return false;
+        }
+        solverStats.presolveRowsRemoved.fetch_add(model.numberRows() - reduced_->numberRows(),
+                                                  memory_order_relaxed);
+        solverStats.presolveColumnsRemoved.fetch_add(
+            model.numberColumns() - reduced_->numberColumns(), memory_order_relaxed);
+        reduced_->setLogLevel(0);
+
+        // Map original columns and rows to the reduced model, keeping only
+        // those whose data presolve did not rewrite
+        const int *originalColumns = presolve_.originalColumns();
+        const int *originalRows = presolve_.originalRows();
+        reducedColumn_.assign(model.numberColumns(), -1);
+        reducedRow_.assign(model.numberRows(), -1);
+        for (int k = 0; k < reduced_->numberColumns(); ++k) {
+            int column = originalColumns[k];
+            if (reduced_->objective()[k] == model.objective()[column]) {
+                reducedColumn_[column] = k;
+            }
+        }
+        for (int k = 0; k < reduced_->numberRows(); ++k) {
+            int row = originalRows[k];
+            if (reduced_->rowLower()[k] == model.rowLower()[row] &&
+                reduced_->rowUpper()[k] == model.rowUpper()[row]) {
+                reducedRow_[row] = k;
+            }
+        }
+        applied_ = base;
+        return true;
+    }
+
+    // Whether `next` only moves data presolve left alone
+    bool covers(const Scenario &next) const {
+        bool totalChanged = next.totalBlend != applied_.totalBlend;
+        for (size_t i = 0; i < next.costs.size(); ++i) {
+            if (next.costs[i] != applied_.costs[i] && reducedColumn_[i] < 0) {
+                return false;
+            }
+        }
+        if (totalChanged && reducedRow_[0] < 0) {
+            return false;
+        }
+        int firstRatioRow = problem_->numComponents() + 1;
+        for (size_t r = 0; totalChanged && r < ratioRows_.size(); ++r) {
+            if (ratioRows_[r].share && reducedRow_[firstRatioRow + r] < 0) {
+                return false;
+            }
+        }
+        for (size_t j = 0; j < next.reqMin.size(); ++j) {
+            if ((totalChanged || next.reqMin[j] != applied_.reqMin[j]) && reducedRow_[j + 1] < 0) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Solves `next`, which has already been applied to the original model.
+    // Returns false if the scenario is not covered() (without solving
+    // anything) or the result is not a proven optimum of the original model.
+    bool solve(ClpSimplex &model, const Scenario &next) {
+        if (!covers(next)) {
+            return false;
+        }
+        bool totalChanged = next.totalBlend != applied_.totalBlend;
+        int firstRatioRow = problem_->numComponents() + 1;
+
+        // Same patches as applyScenario, in reduced numbering
+        int changed = CHANGED_NOTHING;
+        for (size_t i = 0; i < next.costs.size(); ++i) {
+            if (next.costs[i] != applied_.costs[i]) {
+                reduced_->setObjectiveCoefficient(reducedColumn_[i], next.costs[i]);
+                changed |= CHANGED_COSTS;
+            }
+        }
+        if (totalChanged) {
+            reduced_->setRowBounds(reducedRow_[0], next.totalBlend, next.totalBlend);
+            changed |= CHANGED_BOUNDS;
+        }
+        for (size_t j = 0; j < next.reqMin.size(); ++j) {
+            if (totalChanged || next.reqMin[j] != applied_.reqMin[j]) {
+                reduced_->setRowBounds(reducedRow_[j + 1], next.reqMin[j] * next.totalBlend,
+                                       perBlend(problem_->reqMax[j], next.totalBlend));
+                changed |= CHANGED_BOUNDS;
+            }
+        }
+        for (size_t r = 0; totalChanged && r < ratioRows_.size(); ++r) {
+            if (ratioRows_[r].share) {
+                reduced_->setRowBounds(reducedRow_[firstRatioRow + r],
+                                       perBlend(ratioRows_[r].lower, next.totalBlend),
+                                       perBlend(ratioRows_[r].upper, next.totalBlend));
+            }
+        }
+        applied_ = next;
+
+        {
+            BLENDER_TIME_PHASE(PHASE_SIMPLEX);
+            if (!haveBasis_) {
+                runSimplex(*reduced_, false);
+            } else if (changed & CHANGED_BOUNDS) {
+                runSimplex(*reduced_, false);
+            } else if (changed & CHANGED_COSTS) {
+                runSimplex(*reduced_, true);
+            }
+            int iterations = changed || !haveBasis_ ? reduced_->numberIterations() : 0;
+            haveBasis_ = reduced_->isProvenOptimal();
+            if (!haveBasis_) {
+                // Postsolve needs an optimal reduced solution; let the caller
+                // classify this one with a full solve
+                reduced_->allSlackBasis(true);
+                return false;
+            }
+
+            presolve_.postsolve(true);
+            model.checkSolution();
+            if (!model.isProvenOptimal()) {
+                runSimplex(model, true, 1);
+                iterations += model.numberIterations();
+                solverStats.presolveCacheCleanups.fetch_add(1, memory_order_relaxed);
+            }
+            model.setNumberIterations(iterations);
+        }
+        if (!model.isProvenOptimal()) {
+            return false;
+        }
+        if (solveOptions.checkPresolveCache && !matchesFreshSolve(model)) {
+            solverStats.presolveCacheMismatches.fetch_add(1, memory_order_relaxed);
+            return false;
+        }
+        solverStats.presolveCacheHits.fetch_add(1, memory_order_relaxed);
+        recordSolve(model);
+        return true;
+    }
+
+private:
+    // Solves a copy of `model` from scratch, without presolve, and compares
+    // the optimal objective
+    static bool matchesFreshSolve(const ClpSimplex &model) {
+        ClpSimplex fresh(model);
+        fresh.setLogLevel(0);
+        fresh.allSlackBasis(true);
+        fresh.dual();
+        double objective = model.objectiveValue();
+        return fresh.isProvenOptimal() &&
+               fabs(fresh.objectiveValue() - objective) <= 1.0e-7 * max(1.0, fabs(objective));
+    }
+
+    ClpPresolve presolve_;
+    unique_ptr<ClpSimplex> reduced_;
+    vector<int> reducedColumn_;  // original column -> reduced column, -1 if unusable
+    vector<int> reducedRow_;     // original row -> reduced row, -1 if unusable
+    Scenario applied_;           // the data the reduced model currently holds
+    const BlendProblem *problem_ = nullptr;
+    vector<RatioRow> ratioRows_;
+    bool haveBasis_ = false;
+};
+
+
+// --- 8c. RESULT CACHE: Solves keyed on the canonical problem data ---
+
+// Identical problems keep coming back, so a finished solve is kept under a
+// 64-bit hash of its data (costs, the sparse content, specs, total and
+// limits, in ID order). -0.0 is folded into 0.0 and contents at or below the drop
+// tolerance are left out, so data that builds the same model hashes the
+// same. Scenarios never change the content, so it is hashed once per problem
+// and an entry keeps only that fingerprint and the identity of the content
+// arrays; the data an entry stores and compares is the rest (costs, specs,
+// total and limits). An exact hit (same content and the stored data compared,
+// not just the hash) puts the cached solution, duals and basis back into the
+// model without a solve.
+// A near miss with the same structure (sizes and content pattern) lends its
+// basis as a warm start instead of a cold solve.
+//
+// The cache is shared by all solvers, bounded in bytes and evicts the least
+// recently used entry. solveOptions.resultCacheBytes = 0 turns it off, and
+// solveOptions.compactResults stores entries in CompactResults below.
+inline uint64_t hashMix(uint64_t hash, uint64_t value) {
+    value *= 0xff51afd7ed558ccdULL;
+    value ^= value >> 33;
+    hash = (hash ^ value) * 0xc4ceb9fe1a85ec53ULL;
+    return hash ^ (hash >> 29);
+}
+
+inline double canonicalValue(double value) {
+    return value == 0.0 ? 0.0 : value;
+}
+
+inline uint64_t hashValue(uint64_t hash, double value) {
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return hashMix(hash, bits);
+}
+
+// The canonical data of one problem, and its structure and full hashes.
+// The content part is only worked out again when the content arrays (their
+// identity, `content`) change; a view of the same BlendProblem reuses it.
+struct SolveKey {
+    uint64_t structure = 0;
+    uint64_t hash = 0;
+    const int *content = nullptr;  // problem.contentStart the fingerprint is of
+    uint64_t contentHash = 0;      // fingerprint of the kept content
+    vector<double> data;           // costs, specs, total and limits
+
+    void assign(const ProblemView &problem) {
+        if (problem.contentStart != content || problem.dropTolerance != dropTolerance_) {
+            content = problem.contentStart;
+            dropTolerance_ = problem.dropTolerance;
+            contentStructure_ = hashMix(hashMix(0, problem.numFeeds), problem.numComponents);
+            contentHash = 0;
+            for (int i = 0; i < problem.numFeeds; ++i) {
+                contentStructure_ = hashMix(contentStructure_, i);
+                for (int k = problem.contentStart[i]; k < problem.contentStart[i + 1]; ++k) {
+                    double fraction = problem.fraction(k);
+                    if (fabs(fraction) > problem.dropTolerance) {
+                        contentStructure_ = hashMix(contentStructure_, problem.contentComponent[k]);
+                        contentHash = hashValue(contentHash, canonicalValue(fraction));
+                    }
+                }
+            }
+        }
+        data.clear();
+        structure = contentStructure_;
+        uint64_t values = contentHash;
+        for (int i = 0; i < problem.numFeeds; ++i) {
+            values = hashValue(values, canonicalValue(problem.cost[i]));
+            data.push_back(canonicalValue(problem.cost[i]));
+        }
+        for (int j = 0; j < problem.numComponents; ++j) {
+            values = hashValue(values, canonicalValue(problem.reqMin[j]));
+            data.push_back(canonicalValue(problem.reqMin[j]));
+        }
+        values = hashValue(values, canonicalValue(problem.totalBlend));
+        data.push_back(canonicalValue(problem.totalBlend));
+
+        // Limits, when the problem has them
+        auto value = [&](double number) {
+            values = hashValue(values, canonicalValue(number));
+            data.push_back(canonicalValue(number));
+        };
+        if (problem.reqMax) {
+            for (int j = 0; j < problem.numComponents; ++j) {
+                value(problem.reqMax[j]);
+            }
+        }
+        if (problem.available) {
+            for (int i = 0; i < problem.numFeeds; ++i) {
+                value(problem.available[i]);
+            }
+        }
+        for (int r = 0; r < problem.numRatios; ++r) {
+            structure = hashMix(structure, problem.ratioOfTotal[r] ? ~uint64_t(r) : uint64_t(r));
+            for (int k = problem.ratioStart[r]; k < problem.ratioStart[r + 1]; ++k) {
+                structure =
+                    hashMix(structure, uint64_t(problem.ratioFeed[k]) << 2 | problem.ratioPart[k]);
+            }
+            value(problem.ratioLow[r]);
+            value(problem.ratioHigh[r]);
+        }
+        hash = hashMix(structure, values);
+    }
+
+private:
+    double dropTolerance_ = 0.0;
+    uint64_t contentStructure_ = 0;
+};
+
+// Compact storage for result caches that hold a very large number of
+// scenarios (solveOptions.compactResults). Every entry's payload lives in a
+// few shared pools, addressed per slot in structure-of-arrays form:
+//   - the key data (costs, specs, total and limits; not the content, see
+//     SolveKey), compared exactly on lookup
+//   - the primal solution as (column, value) pairs of its nonzeros
+//   - the row duals, dense (a blend has few rows)
+//   - the basis at 2 bits per variable. A basis with a free or superbasic
+//     variable is not kept, and the entry cannot lend a warm start.
+// Row activities and reduced costs are not kept at all: restore() rebuilds
+// them from the model's matrix, so they agree with the solve to rounding.
+// Removed entries leave holes in the pools, squeezed out once they outweigh
+// the live data. The content, held once per process, is what float32 is for:
+// with compactResults set, main() narrows it (BlendProblem::narrowContent).
+const size_t COMPACT_MIN_GARBAGE = 1 << 20;
+
+class CompactResults {
+public:
+    // Stores the solve of `key` in `model`; returns its slot and sets `bytes`
+    // to the memory the slot holds
+    uint32_t add(const SolveKey &key, const ClpSimplex &model, size_t &bytes) {
+        uint32_t slot;
+        if (!freeSlots_.empty()) {
+            slot = freeSlots_.back();
+            freeSlots_.pop_back();
+        } else {
+            slot = data_.size();
+            data_.emplace_back();
+            primal_.emplace_back();
+            duals_.emplace_back();
+            basis_.emplace_back();
+        }
+        int numColumns = model.numberColumns();
+        int numRows = model.numberRows();
+
+        data_[slot] = {doubles_.size(), static_cast<uint32_t>(key.data.size())};
+        doubles_.insert(doubles_.end(), key.data.begin(), key.data.end());
+
+        const double *columnSolution = model.primalColumnSolution();
+        primal_[slot].start = columnIndices_.size();
+        for (int i = 0; i < numColumns; ++i) {
+            if (columnSolution[i] != 0.0) {
+                columnIndices_.push_back(i);
+                columnValues_.push_back(columnSolution[i]);
+            }
+        }
+        primal_[slot].count = columnIndices_.size() - primal_[slot].start;
+
+        duals_[slot] = {doubles_.size(), static_cast<uint32_t>(numRows)};
+        doubles_.insert(doubles_.end(), model.dualRowSolution(), model.dualRowSolution() + numRows);
+
+        basis_[slot] = {statuses_.size(), 0};
+        const unsigned char *status = model.statusArray();
+        uint32_t numStatus = numColumns + numRows;
+        if (status && all_of(status, status + numStatus,
+                             [](unsigned char s) { return basisCode(s) >= 0; })) {
+            basis_[slot].count = numStatus;
+            statuses_.resize(statuses_.size() + (numStatus + 3) / 4, 0);
+            for (uint32_t k = 0; k < numStatus; ++k) {
+                statuses_[basis_[slot].start + k / 4] |= basisCode(status[k]) << (2 * (k % 4));
+            }
+        }
+
+        bytes = slotBytes(slot);
+        liveBytes_ += bytes;
+        return slot;
+    }
+
+    bool matches(uint32_t slot, const vector<double> &data) const {
+        const Range &range = data_[slot];
+        return data.size() == range.count &&
+               equal(data.begin(), data.end(), doubles_.begin() + range.start);
+    }
+
+    // Puts the solution, duals and basis back into `model` (the blend models
+    // minimize, so a reduced cost is c - A'y)
+    void restore(uint32_t slot, ClpSimplex &model) const {
+        int numColumns = model.numberColumns();
+        double *columnSolution = model.primalColumnSolution();
+        fill(columnSolution, columnSolution + numColumns, 0.0);
+        const Range &primal = primal_[slot];
+        for (uint32_t k = primal.start; k < primal.start + primal.count; ++k) {
+            columnSolution[columnIndices_[k]] = columnValues_[k];
+        }
+        const Range &duals = duals_[slot];
+        double *rowDuals = model.dualRowSolution();
+        copy(doubles_.begin() + duals.start, doubles_.begin() + duals.start + duals.count,
+             rowDuals);
+
+        const CoinPackedMatrix *matrix = model.matrix();
+        matrix->times(columnSolution, model.primalRowSolution());
+        double *reducedCosts = model.dualColumnSolution();
+        matrix->transposeTimes(rowDuals, reducedCosts);
+        const double *cost = model.getObjCoefficients();
+        for (int i = 0; i < numColumns; ++i) {
+            reducedCosts[i] = cost[i] - reducedCosts[i];
+        }
+        copyBasis(slot, model);
+    }
+
+    // Copies the stored basis into `model`; false if there is none for it
+    bool copyBasis(uint32_t slot, ClpSimplex &model) const {
+        const Range &basis = basis_[slot];
+        if (basis.count == 0 ||
+            static_cast<int>(basis.count) != model.numberColumns() + model.numberRows()) {
+            return false;
+        }
+        static const unsigned char BASIS_STATUS[4] = {
+            ClpSimplex::atLowerBound, ClpSimplex::basic, ClpSimplex::atUpperBound,
+            ClpSimplex::isFixed};
+        vector<unsigned char> status(basis.count);
+        for (uint32_t k = 0; k < basis.count; ++k) {
+            status[k] = BASIS_STATUS[statuses_[basis.start + k / 4] >> (2 * (k % 4)) & 3];
+        }
+        model.copyinStatus(status.data());
+        return true;
+    }
+
+    void remove(uint32_t slot) {
+        size_t bytes = slotBytes(slot);
+        liveBytes_ -= bytes;
+        garbageBytes_ += bytes - SLOT_BYTES;
+        data_[slot].count = primal_[slot].count = duals_[slot].count = basis_[slot].count = 0;
+        freeSlots_.push_back(slot);
+        if (garbageBytes_ > COMPACT_MIN_GARBAGE && garbageBytes_ > liveBytes_) {
+            squeeze();
+        }
+    }
+
+private:
+    struct Range {
+        size_t start;
+        uint32_t count;
+    };
+    static const size_t SLOT_BYTES = 4 * sizeof(Range);
+
+    // 2-bit codes of the statuses a simplex basis is made of, -1 for the rest
+    static int basisCode(unsigned char status) {
+        switch (status & 7) {
+        case ClpSimplex::atLowerBound:
+            return 0;
+        case ClpSimplex::basic:
+            return 1;
+        case ClpSimplex::atUpperBound:
+            return 2;
+        case ClpSimplex::isFixed:
+            return 3;
+        default:
+            return -1;
+        }
+    }
+
+    size_t slotBytes(uint32_t slot) const {
+        return SLOT_BYTES + data_[slot].count * sizeof(double) +
+               primal_[slot].count * (sizeof(int) + sizeof(double)) +
+               duals_[slot].count * sizeof(double) + (basis_[slot].count + 3) / 4;
+    }
+
+    // Rewrites the pools with the live ranges only, in slot order
+    void squeeze() {
+        vector<double> doubles;
+        vector<int> columnIndices;
+        vector<double> columnValues;
+        vector<unsigned char> statuses;
+        auto keep = [](const auto &from, auto &to, Range &range, size_t length) {
+            size_t start = to.size();
+            to.insert(to.end(), from.begin() + range.start, from.begin() + range.start + length);
+            range.start = start;
+        };
+        for (uint32_t slot = 0; slot < data_.size(); ++slot) {
+            keep(doubles_, doubles, data_[slot], data_[slot].count);
+            Range values = primal_[slot];
+            keep(columnIndices_, columnIndices, primal_[slot], primal_[slot].count);
+            keep(columnValues_, columnValues, values, values.count);
+            keep(doubles_, doubles, duals_[slot], duals_[slot].count);
+            keep(statuses_, statuses, basis_[slot], (basis_[slot].count + 3) / 4);
+        }
+        doubles_.swap(doubles);
+        columnIndices_.swap(columnIndices);
+        columnValues_.swap(columnValues);
+        statuses_.swap(statuses);
+        garbageBytes_ = 0;
+    }
+
+    // Per slot
+    vector<Range> data_;    // into doubles_
+    vector<Range> primal_;  // into columnIndices_ and columnValues_
+    vector<Range> duals_;   // into doubles_
+    vector<Range> basis_;   // count statuses, 4 per byte of statuses_
+    vector<uint32_t> freeSlots_;
+
+    // Pools
+    vector<double> doubles_;
+    vector<int> columnIndices_;
+    vector<double> columnValues_;
+    vector<unsigned char> statuses_;
+    size_t liveBytes_ = 0;
+    size_t garbageBytes_ = 0;
+};
+
+class SolveCache {
+public:
+    // With `compact` set the entries are kept in CompactResults
+    SolveCache(size_t capacityBytes, bool compact)
+        : capacityBytes_(capacityBytes), compact_(compact) {}
+
+    // Exact hit: installs the cached solve into `model`, which must already
+    // hold the same problem
+    bool restore(const SolveKey &key, ClpSimplex &model) {
+        lock_guard<mutex> lock(mutex_);
+        auto found = entries_.find(key.hash);
+        if (found == entries_.end() || !matches(*found->second, key)) {
+            solverStats.resultCacheMisses.fetch_add(1, memory_order_relaxed);
+            return false;
+        }
+        const Entry &entry = *found->second;
+        lru_.splice(lru_.begin(), lru_, found->second);
+
+        if (compact_) {
+            packed_.restore(entry.slot, model);
+        } else {
+            const DenseResult &result = dense_[entry.slot];
+            copy(result.columnSolution.begin(), result.columnSolution.end(),
+                 model.primalColumnSolution());
+            copy(result.rowActivity.begin(), result.rowActivity.end(), model.primalRowSolution());
+            copy(result.reducedCosts.begin(), result.reducedCosts.end(), model.dualColumnSolution());
+            copy(result.rowDuals.begin(), result.rowDuals.end(), model.dualRowSolution());
+            copyBasis(entry, model);
+        }
+        model.setObjectiveValue(entry.objective);
+        model.setProblemStatus(0);
+        model.setNumberIterations(0);
+        solverStats.resultCacheHits.fetch_add(1, memory_order_relaxed);
+        return true;
+    }
+
+    // Near miss: copies the basis of the most recent solve with the same
+    // structure into `model`
+    bool warmStart(const SolveKey &key, ClpSimplex &model) {
+        lock_guard<mutex> lock(mutex_);
+        auto found = latest_.find(key.structure);
+        if (found == latest_.end() || !copyBasis(*found->second, model)) {
+            return false;
+        }
+        solverStats.resultCacheWarmStarts.fetch_add(1, memory_order_relaxed);
+        return true;
+    }
+
+    // Keeps an optimal solve of the problem `key` describes
+    void store(const SolveKey &key, const ClpSimplex &model) {
+        if (!model.isProvenOptimal() || capacityBytes_ == 0) {
+            return;
+        }
+        Entry entry{key.hash, key.structure, key.content, key.contentHash, model.getObjValue(),
+                    sizeof(Entry), 0};
+        DenseResult result;
+        if (!compact_) {
+            int numColumns = model.numberColumns();
+            int numRows = model.numberRows();
+            result.data = key.data;
+            result.columnSolution.assign(model.primalColumnSolution(),
+                                         model.primalColumnSolution() + numColumns);
+            result.rowActivity.assign(model.primalRowSolution(), model.primalRowSolution() + numRows);
+            result.reducedCosts.assign(model.dualColumnSolution(),
+                                       model.dualColumnSolution() + numColumns);
+            result.rowDuals.assign(model.dualRowSolution(), model.dualRowSolution() + numRows);
+            if (const unsigned char *basis = model.statusArray()) {
+                result.basis.assign(basis, basis + numColumns + numRows);
+            }
+            entry.bytes += sizeof(DenseResult) + result.data.size() * sizeof(double) +
+                           (2 * numColumns + 2 * numRows) * sizeof(double) + result.basis.size();
+            if (entry.bytes > capacityBytes_) {
+                return;
+            }
+        }
+
+        lock_guard<mutex> lock(mutex_);
+        auto found = entries_.find(key.hash);
+        if (found != entries_.end()) {
+            erase(found->second);
+        }
+        if (compact_) {
+            size_t bytes;
+            entry.slot = packed_.add(key, model, bytes);
+            entry.bytes += bytes;
+            if (entry.bytes > capacityBytes_) {
+                packed_.remove(entry.slot);
+                return;
+            }
+        } else if (!freeDense_.empty()) {
+            entry.slot = freeDense_.back();
+            freeDense_.pop_back();
+            dense_[entry.slot] = move(result);
+        } else {
+            entry.slot = dense_.size();
+            dense_.push_back(move(result));
+        }
+        lru_.push_front(entry);
+        entries_[key.hash] = lru_.begin();
+        latest_[key.structure] = lru_.begin();
+        bytes_ += entry.bytes;
+        while (bytes_ > capacityBytes_) {
+            erase(prev(lru_.end()));
+            solverStats.resultCacheEvictions.fetch_add(1, memory_order_relaxed);
+        }
+        solverStats.resultCacheEntries.store(lru_.size(), memory_order_relaxed);
+        solverStats.resultCacheBytes.store(bytes_, memory_order_relaxed);
+    }
+
+private:
+    struct Entry {
+        uint64_t hash;
+        uint64_t structure;
+        const int *content;  // SolveKey::content and contentHash
+        uint64_t contentHash;
+        double objective;
+        size_t bytes;
+        uint32_t slot;  // in dense_ or packed_
+    };
+    using EntryList = list<Entry>;
+
+    struct DenseResult {
+        vector<double> data;
+        vector<double> columnSolution;
+        vector<double> rowActivity;
+        vector<double> reducedCosts;
+        vector<double> rowDuals;
+        vector<unsigned char> basis;  // ClpSimplex::statusArray(), columns then rows
+    };
+
+    bool matches(const Entry &entry, const SolveKey &key) const {
+        if (entry.content != key.content || entry.contentHash != key.contentHash) {
+            return false;
+        }
+        return compact_ ? packed_.matches(entry.slot, key.data) : dense_[entry.slot].data == key.data;
+    }
+
+    bool copyBasis(const Entry &entry, ClpSimplex &model) const {
+        if (compact_) {
+            return packed_.copyBasis(entry.slot, model);
+        }
+        const vector<unsigned char> &basis = dense_[entry.slot].basis;
+        if (static_cast<int>(basis.size()) != model.numberColumns() + model.numberRows()) {
+            return false;
+        }
+        model.copyinStatus(basis.data());
+        return true;
+    }
+
+    void erase(EntryList::iterator entry) {
+        auto latest = latest_.find(entry->structure);
+        if (latest != latest_.end() && latest->second == entry) {
+            latest_.erase(latest);
+        }
+        if (compact_) {
+            packed_.remove(entry->slot);
+        } else {
+            dense_[entry->slot] = DenseResult();
+            freeDense_.push_back(entry->slot);
+        }
+        entries_.erase(entry->hash);
+        bytes_ -= entry->bytes;
+        lru_.erase(entry);
+    }
+
+    size_t capacityBytes_;
+    bool compact_;
+    size_t bytes_ = 0;
+    mutex mutex_;
+    EntryList lru_;  // most recently used first
+    unordered_map<uint64_t, EntryList::iterator> entries_;
+    unordered_map<uint64_t, EntryList::iterator> latest_;  // newest entry per structure
+    vector<DenseResult> dense_;
+    vector<uint32_t> freeDense_;
+    CompactResults packed_;
+};
+
+// The process-wide cache, created (and owned) by main() when --result-cache
+// is given. A plain pointer, so the global is constant-initialized.
+SolveCache *resultCache = nullptr;
+
+
+// One model kept alive across scenarios, plus the scratch memory to (re)build
+// it. With `cold` set, every scenario gets a freshly built model and a full
+// coldSolve() instead, which is what one process per scenario costs (minus
+// the fork/exec). With solveOptions.presolveCache set, warm scenarios are
+// solved through a PresolveCache, which is presolved again around any
+// scenario it does not cover; coldSolve() (a full presolve) takes the ones it
+// still refuses. The problem is only read, so any number of
+// solvers can share it.
+class ScenarioSolver {
+public:
+    ScenarioSolver(const BlendProblem &problem, bool cold)
+        : problem_(problem), cold_(cold), base_(baseScenario(problem)), current_(base_) {
+        buildModel(model_, problem_, arena_);
+        model_.setLogLevel(0);
+        setupAllocations_ = arena_.allocations();
+        if (!cold_ && solveOptions.presolveCache) {
+            cache_.reset(new PresolveCache);
+            if (!cache_->build(model_, problem_, base_)) {
+                cache_.reset();
+            }
+        }
+    }
+
+    ScenarioResult solve(const Scenario &next) {
+        if (resultCache) {
+            ProblemView view = problem_.view();
+            view.cost = next.costs.data();
+            view.reqMin = next.reqMin.data();
+            view.totalBlend = next.totalBlend;
+            key_.assign(view);
+        }
+
+        if (cold_) {
+            coldModel_.reset(new ClpSimplex);
+            buildModel(*coldModel_, problem_, arena_);
+            coldModel_->setLogLevel(0);
+            applyScenario(*coldModel_, problem_, base_, next);
+            if (resultCache && resultCache->restore(key_, *coldModel_)) {
+                return resultOf(*coldModel_);
+            }
+            if (resultCache && resultCache->warmStart(key_, *coldModel_)) {
+                warmSolve(*coldModel_, CHANGED_COSTS | CHANGED_BOUNDS);
+            } else {
+                coldSolve(*coldModel_);
+            }
+            if (resultCache) {
+                resultCache->store(key_, *coldModel_);
+            }
+            return resultOf(*coldModel_);
+        }
+
+        int changed = applyScenario(model_, problem_, current_, next);
+        bool hit = resultCache && resultCache->restore(key_, model_);
+        if (hit) {
+            // The cached basis is optimal for this scenario, so it is as good
+            // a start for the next one as a solve would have left
+        } else if (cache_) {
+            if (!cache_->covers(next)) {
+                // Presolve removed or rewrote data this scenario moves: presolve
+                // again around it (model_ already holds it), so the scenarios
+                // after it can use the cache too
+                cache_.reset(new PresolveCache);
+                if (cache_->build(model_, problem_, next)) {
+                    solverStats.presolveCacheRebuilds.fetch_add(1, memory_order_relaxed);
+                } else {
+                    cache_.reset();
+                }
+            }
+            if (!cache_ || !cache_->solve(model_, next)) {
+                solverStats.presolveCacheFallbacks.fetch_add(1, memory_order_relaxed);
+                coldSolve(model_);
+            }
+        } else if (haveBasis_) {
+            warmSolve(model_, changed);
+        } else {
+            coldSolve(model_);
+        }
+        current_ = next;
+        // A failed solve leaves no basis worth starting from
+        haveBasis_ = model_.isProvenOptimal();
+        // A hit is already cached; storing it again would only re-copy it
+        if (resultCache && !hit) {
+            resultCache->store(key_, model_);
+        }
+        return resultOf(model_);
+    }
+
+    // The model the last scenario was solved on
+    const ClpSimplex &lastModel() const { return cold_ ? *coldModel_ : model_; }
+
+    // Builder allocations made after the initial build
+    long extraAllocations() const { return arena_.allocations() - setupAllocations_; }
+    size_t arenaCapacity() const { return arena_.capacity(); }
+
+private:
+    static ScenarioResult resultOf(const ClpSimplex &model) {
+        ScenarioResult result;
+        result.status = model.status();
+        result.objective = model.isProvenOptimal() ? model.getObjValue() : 0.0;
+        result.iterations = model.numberIterations();
+        return result;
+    }
+
+    const BlendProblem &problem_;
+    bool cold_;
+    Scenario base_;
+    Scenario current_;
+    BuildArena arena_;
+    ClpSimplex model_;
+    unique_ptr<ClpSimplex> coldModel_;
+    unique_ptr<PresolveCache> cache_;
+    SolveKey key_;
+    bool haveBasis_ = false;
+    long setupAllocations_ = 0;
+};
+
+// Batch statistics go to stdout after a table and to stderr after NDJSON, so
+// the NDJSON stream stays machine readable.
+ostream &statsStream(OutputFormat format) {
+    return format == OUTPUT_NDJSON ? cerr : cout;
+}
+
+void printThroughput(ostream &out, long numScenarios, long numOptimal, long totalIterations,
+                     double seconds, bool cold) {
+    out << "\nSolved " << numScenarios << " scenarios (" << numOptimal << " optimal) in "
+         << seconds << " s using " << (cold ? "cold" : "warm") << " starts" << endl;
+    out << "Throughput: " << (seconds > 0.0 ? numScenarios / seconds : 0.0)
+         << " scenarios/s, " << totalIterations << " simplex iterations" << endl;
+    out << "Peak RSS: " << peakRssBytes() / double(1 << 20) << " MB";
+    if (resultCache) {
+        out << " (result cache " << solverStats.resultCacheEntries.load() << " entries, "
+            << solverStats.resultCacheBytes.load() / double(1 << 20) << " MB"
+            << (solveOptions.compactResults ? ", compact" : "") << ")";
+    }
+    out << endl;
+    if (solverStats.stallRemedies[REMEDY_PERTURB].load() > 0) {
+        out << "Stall remedies:";
+        for (int remedy = 0; remedy < NUM_STALL_REMEDIES; ++remedy) {
+            out << " " << STALL_REMEDY_NAMES[remedy] << " " << solverStats.stallRemedies[remedy]
+                << " (" << solverStats.stallRemedySuccesses[remedy] << " finished)";
+        }
+        out << ", " << solverStats.stallsUnresolved << " unresolved" << endl;
+    }
+}
+
+// Rows and columns of the models buildModel() makes of `problem`, for
+// sizing a result archive before the first solve
+int modelColumns(const BlendProblem &problem) {
+    return problem.numFeeds();
+}
+
+int modelRows(const BlendProblem &problem) {
+    vector<RatioRow> rows;  // a ratio limit makes zero, one or two rows
+    ratioRows(problem.view(), rows);
+    return problem.numComponents() + 1 + rows.size();
+}
+
+// Closes an archive written by a batch run; false (after saying why) if
+// any of it could not be written
+bool closeArchive(ResultArchiveWriter *archive) {
+    string error;
+    if (archive && !archive->close(error)) {
+        cerr << "Cannot write result archive: " << error << endl;
+        return false;
+    }
+    return true;
+}
+
+// Solves every scenario on the stream, one at a time, and reports throughput.
+// NDJSON output carries the full solution, reduced costs and duals of every
+// scenario; the table lists one line per scenario. With `archivePath` the
+// solutions also go to a result archive.
+int runBatch(istream &in, const BlendProblem &problem, bool cold, ResultWriter &writer,
+             const char *archivePath) {
+    ScenarioSolver solver(problem, cold);
+    unique_ptr<ResultArchiveWriter> archive;
+    if (archivePath) {
+        string error;
+        archive.reset(new ResultArchiveWriter);
+        if (!archive->create(archivePath, modelColumns(problem), modelRows(problem), 0, error)) {
+            cerr << "Cannot write result archive: " << error << endl;
+            return 1;
+        }
+    }
+
+    Scenario next;
+    long lineNumber = 0;
+    long numScenarios = 0;
+    long numOptimal = 0;
+    long totalIterations = 0;
+
+    auto startTime = chrono::steady_clock::now();
+
+    while (readScenario(in, problem, next, lineNumber)) {
+        ScenarioResult result = solver.solve(next);
+        ++numScenarios;
+        totalIterations += result.iterations;
+        numOptimal += result.status == 0;
+        if (writer.format() == OUTPUT_NDJSON) {
+            writer.writeSolution(numScenarios, solver.lastModel(), problem);
+        } else {
+            writer.writeSummary(numScenarios, result);
+        }
+        if (archive) {
+            archive->write(numScenarios, solver.lastModel());
+        }
+    }
+    writer.flush();
+    if (!closeArchive(archive.get())) {
+        return 1;
+    }
+
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - startTime).count();
+
+    ostream &stats = statsStream(writer.format());
+    printThroughput(stats, numScenarios, numOptimal, totalIterations, seconds, cold);
+    stats << "Builder arena: " << solver.extraAllocations()
+         << " heap allocations after the first build (" << solver.arenaCapacity()
+         << " bytes reserved)" << endl;
+    return 0;
+}
+
+
+// --- 8d. SMALL-LP KERNEL: Dense vertex enumeration, several scenarios per pass ---
+
+// For problems the size of the shipped example, setting up a ClpSimplex costs
+// far more than the arithmetic. In standard form (one surplus column per
+// spec row) the model has M = NC + 1 rows and N = NF + NC columns, and its
+// feasible region is bounded (the blend total is fixed), so the optimum is
+// at one of at most C(N, M) basic solutions. Scenarios share the content
+// matrix, so every basis inverse is computed once per problem; a scenario
+// only moves the right-hand side T * (1, reqMin) and the costs. With both
+// counts fixed at compile time, solving SMALL_LANES scenarios is a handful
+// of fixed-size, branch-free loops over the lanes, which the compiler turns
+// into AVX2 / AVX-512 code (-O3 -march=native).
+//
+// A problem whose content matrix leaves some basis close to singular is not
+// taken on at all, and a lane with no feasible basis is left for ClpSimplex,
+// which owns the infeasibility verdict.
+const int SMALL_LANES = 8;
+const int SMALL_MAX_FEEDS = 6;
+const int SMALL_MAX_COMPONENTS = 4;
+
+const double SMALL_SINGULAR_PIVOT = 1.0e-11;    // below: not a basis
+const double SMALL_ILL_CONDITIONED = 1.0e-7;    // below (and above singular): leave to CLP
+const double SMALL_PRIMAL_TOLERANCE = 1.0e-9;   // relative to the blend total
+
+class SmallBlendSolver {
+public:
+    virtual ~SmallBlendSolver() {}
+
+    // Solves scenarios[0 .. count), count <= SMALL_LANES. A result with
+    // status -1 was not decided here and needs ClpSimplex.
+    virtual void solve(const Scenario *scenarios, int count, ScenarioResult *results) const = 0;
+};
+
+constexpr int binomial(int n, int k) {
+    int result = 1;
+    for (int i = 1; i <= k; ++i) {
+        result = result * (n - k + i) / i;
+    }
+    return result;
+}
+
+template <int NF, int NC>
+class SmallBlendKernel : public SmallBlendSolver {
+public:
+    static constexpr int M = NC + 1;
+    static constexpr int N = NF + NC;
+    static constexpr int NUM_BASES = binomial(N, M);
+
+    struct Bases {
+        int column[NUM_BASES][M];
+    };
+
+    // All M-column subsets of 0..N-1 in lexicographic order
+    static constexpr Bases enumerateBases() {
+        Bases bases{};
+        int pick[M] = {};
+        for (int r = 0; r < M; ++r) {
+            pick[r] = r;
+        }
+        for (int k = 0; k < NUM_BASES; ++k) {
+            for (int r = 0; r < M; ++r) {
+                bases.column[k][r] = pick[r];
+            }
+            int r = M - 1;
+            while (r >= 0 && pick[r] == N - M + r) {
+                --r;
+            }
+            if (r >= 0) {
+                ++pick[r];
+                for (int s = r + 1; s < M; ++s) {
+                    pick[s] = pick[s - 1] + 1;
+                }
+            }
+        }
+        return bases;
+    }
+
+    static constexpr Bases BASES = enumerateBases();
+
+    // Inverts every basis of the problem's content matrix. usable() is false
+    // when one of them is too close to singular to trust.
+    explicit SmallBlendKernel(const BlendProblem &problem) {
+        double column[N][M] = {};
+        for (int i = 0; i < NF; ++i) {
+            column[i][0] = 1.0;
+            for (int j = 0; j < NC; ++j) {
+                double fraction = problem.contentOf(i, j);
+                column[i][j + 1] = fabs(fraction) > problem.dropTolerance ? fraction : 0.0;
+            }
+        }
+        for (int j = 0; j < NC; ++j) {
+            column[NF + j][j + 1] = -1.0;
+        }
+
+        for (int k = 0; k < NUM_BASES; ++k) {
+            // Gauss-Jordan with partial pivoting on [B | I]
+            double a[M][2 * M] = {};
+            for (int r = 0; r < M; ++r) {
+                for (int c = 0; c < M; ++c) {
+                    a[r][c] = column[BASES.column[k][c]][r];
+                }
+                a[r][M + r] = 1.0;
+            }
+            bool singular = false;
+            for (int c = 0; c < M && !singular; ++c) {
+                int pivot = c;
+                for (int r = c + 1; r < M; ++r) {
+                    if (fabs(a[r][c]) > fabs(a[pivot][c])) {
+                        pivot = r;
+                    }
+                }
+                double size = fabs(a[pivot][c]);
+                if (size < SMALL_SINGULAR_PIVOT) {
+                    singular = true;
+                    break;
+                }
+                if (size < SMALL_ILL_CONDITIONED) {
+                    usable_ = false;
+                }
+                for (int s = 0; s < 2 * M; ++s) {
+                    swap(a[c][s], a[pivot][s]);
+                }
+                double scale = 1.0 / a[c][c];
+                for (int s = 0; s < 2 * M; ++s) {
+                    a[c][s] *= scale;
+                }
+                for (int r = 0; r < M; ++r) {
+                    if (r != c && a[r][c] != 0.0) {
+                        double factor = a[r][c];
+                        for (int s = 0; s < 2 * M; ++s) {
+                            a[r][s] -= factor * a[c][s];
+                        }
+                    }
+                }
+            }
+            if (singular) {
+                continue;
+            }
+            Basis &basis = bases_[numBases_++];
+            for (int r = 0; r < M; ++r) {
+                basis.column[r] = BASES.column[k][r];
+                for (int c = 0; c < M; ++c) {
+                    basis.inverse[r][c] = a[r][M + c];
+                }
+            }
+        }
+    }
+
+    bool usable() const { return usable_; }
+
+    void solve(const Scenario *scenarios, int count, ScenarioResult *results) const override {
+        // Lane l holds scenario min(l, count - 1); the copies are ignored
+        alignas(64) double cost[N][SMALL_LANES] = {};  // surplus columns cost nothing
+        alignas(64) double rhs[M][SMALL_LANES];
+        alignas(64) double tolerance[SMALL_LANES];
+        for (int l = 0; l < SMALL_LANES; ++l) {
+            const Scenario &scenario = scenarios[min(l, count - 1)];
+            for (int i = 0; i < NF; ++i) {
+                cost[i][l] = scenario.costs[i];
+            }
+            rhs[0][l] = scenario.totalBlend;
+            for (int j = 0; j < NC; ++j) {
+                rhs[j + 1][l] = scenario.reqMin[j] * scenario.totalBlend;
+            }
+            tolerance[l] = -SMALL_PRIMAL_TOLERANCE * max(1.0, fabs(scenario.totalBlend));
+        }
+
+        alignas(64) double best[SMALL_LANES];
+        for (int l = 0; l < SMALL_LANES; ++l) {
+            best[l] = INFINITY;
+        }
+        for (int k = 0; k < numBases_; ++k) {
+            const Basis &basis = bases_[k];
+            alignas(64) double objective[SMALL_LANES] = {};
+            alignas(64) double lowest[SMALL_LANES];
+            for (int l = 0; l < SMALL_LANES; ++l) {
+                lowest[l] = INFINITY;
+            }
+            for (int r = 0; r < M; ++r) {
+                alignas(64) double value[SMALL_LANES] = {};
+                for (int c = 0; c < M; ++c) {
+                    double entry = basis.inverse[r][c];
+                    for (int l = 0; l < SMALL_LANES; ++l) {
+                        value[l] += entry * rhs[c][l];
+                    }
+                }
+                const double *columnCost = cost[basis.column[r]];
+                for (int l = 0; l < SMALL_LANES; ++l) {
+                    objective[l] += columnCost[l] * value[l];
+                    lowest[l] = min(lowest[l], value[l]);
+                }
+            }
+            for (int l = 0; l < SMALL_LANES; ++l) {
+                bool better = lowest[l] >= tolerance[l] && objective[l] < best[l];
+                best[l] = better ? objective[l] : best[l];
+            }
+        }
+
+        for (int l = 0; l < count; ++l) {
+            if (best[l] < INFINITY) {
+                results[l] = ScenarioResult{0, best[l], 0};
+            } else {
+                results[l] = ScenarioResult{-1, 0.0, 0};
+            }
+        }
+    }
+
+private:
+    struct Basis {
+        int column[M];
+        double inverse[M][M];
+    };
+
+    Basis bases_[NUM_BASES];
+    int numBases_ = 0;
+    bool usable_ = true;
+};
+
+template <int NF, int NC>
+constexpr typename SmallBlendKernel<NF, NC>::Bases SmallBlendKernel<NF, NC>::BASES;
+
+template <int NF, int NC>
+unique_ptr<SmallBlendSolver> makeSmallKernel(const BlendProblem &problem) {
+    if (problem.numFeeds() == NF && problem.numComponents() == NC) {
+        unique_ptr<SmallBlendKernel<NF, NC>> kernel(new SmallBlendKernel<NF, NC>(problem));
+        if (!kernel->usable()) {
+            return nullptr;
+        }
+        return unique_ptr<SmallBlendSolver>(kernel.release());
+    }
+    if constexpr (NC < SMALL_MAX_COMPONENTS) {
+        if (problem.numFeeds() == NF) {
+            return makeSmallKernel<NF, NC + 1>(problem);
+        }
+    }
+    if constexpr (NF < SMALL_MAX_FEEDS) {
+        if (problem.numFeeds() > NF) {
+            return makeSmallKernel<NF + 1, 1>(problem);
+        }
+    }
+    return nullptr;
+}
+
+// The kernel for the problem's shape, or null if it is too large (or
+// numerically unsuitable, or has limits the kernel does not model) and
+// ClpSimplex has to do everything.
+unique_ptr<SmallBlendSolver> makeSmallBlendSolver(const BlendProblem &problem) {
+    if (problem.hasLimits() || problem.numFeeds() < 1 || problem.numFeeds() > SMALL_MAX_FEEDS ||
+        problem.numComponents() < 1 || problem.numComponents() > SMALL_MAX_COMPONENTS) {
+        return nullptr;
+    }
+    return makeSmallKernel<1, 1>(problem);
+}
+
+
+// --- 8e. BASIS STORE: Optimal bases kept across runs ---
+
+// Today's model is usually yesterday's with new prices, and yesterday's
+// optimal basis is optimal or nearly so. After an optimal solve the basis is
+// saved under the model's signature (its dimensions and matrix pattern),
+// one file per signature in solveOptions.basisDir; the next run of the same
+// model starts the dual simplex from it instead of presolving and solving
+// from a slack basis.
+//
+// File layout: BasisHeader, then one 4-bit ClpSimplex::Status per column
+// and row (columns first, low nibble first). Files are written to a
+// temporary name and renamed, so a crash never leaves a torn basis, and a
+// file that does not match the model, or does not hold exactly one basic
+// variable per row, is ignored.
+const char BASIS_MAGIC[8] = {'B', 'L', 'N', 'D', 'B', 'A', 'S', '1'};
+
+struct BasisHeader {
+    char magic[8];
+    uint64_t signature;
+    int32_t numColumns;
+    int32_t numRows;
+};
+
+uint64_t modelSignature(const ClpSimplex &model) {
+    const CoinPackedMatrix *matrix = model.matrix();
+    const CoinBigIndex *starts = matrix->getVectorStarts();
+    const int *lengths = matrix->getVectorLengths();
+    const int *indices = matrix->getIndices();
+    uint64_t signature = hashMix(hashMix(0, model.numberColumns()), model.numberRows());
+    for (int column = 0; column < model.numberColumns(); ++column) {
+        signature = hashMix(signature, lengths[column]);
+        for (CoinBigIndex k = starts[column]; k < starts[column] + lengths[column]; ++k) {
+            signature = hashMix(signature, indices[k]);
+        }
+    }
+    return signature;
+}
+
+string basisPath(const char *dir, uint64_t signature) {
+    char name[32];
+    snprintf(name, sizeof(name), "%016llx.basis", static_cast<unsigned long long>(signature));
+    return string(dir) + "/" + name;
+}
+
+bool saveBasis(const char *dir, const ClpSimplex &model, string &error) {
+    const unsigned char *status = model.statusArray();
+    if (!status) {
+        error = "model has no basis";
+        return false;
+    }
+    BasisHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, BASIS_MAGIC, sizeof(header.magic));
+    header.signature = modelSignature(model);
+    header.numColumns = model.numberColumns();
+    header.numRows = model.numberRows();
+
+    size_t numStatus = static_cast<size_t>(header.numColumns) + header.numRows;
+    vector<char> image(sizeof(header) + (numStatus + 1) / 2, 0);
+    memcpy(&image[0], &header, sizeof(header));
+    for (size_t k = 0; k < numStatus; ++k) {
+        image[sizeof(header) + k / 2] |= (status[k] & 7) << (k % 2 ? 4 : 0);
+    }
+
+    string path = basisPath(dir, header.signature);
+    string temporary = path + ".tmp";
+    if (!writeWholeFile(temporary.c_str(), image.data(), image.size(), error)) {
+        return false;
+    }
+    if (rename(temporary.c_str(), path.c_str()) != 0) {
+        error = "cannot replace " + path + ": " + strerror(errno);
+        return false;
+    }
+    return true;
+}
+
+// Installs the stored basis for this model, if there is a usable one
+bool loadBasis(const char *dir, ClpSimplex &model) {
+    uint64_t signature = modelSignature(model);
+    vector<char> image;
+    string error;
+    if (!readWholeFile(basisPath(dir, signature).c_str(), image, error)) {
+        return false;
+    }
+
+    BasisHeader header;
+    size_t numStatus = static_cast<size_t>(model.numberColumns()) + model.numberRows();
+    if (image.size() != sizeof(header) + (numStatus + 1) / 2) {
+        return false;
+    }
+    memcpy(&header, image.data(), sizeof(header));
+    if (memcmp(header.magic, BASIS_MAGIC, sizeof(header.magic)) != 0 ||
+        header.signature != signature || header.numColumns != model.numberColumns() ||
+        header.numRows != model.numberRows()) {
+        return false;
+    }
+
+    vector<unsigned char> status(numStatus);
+    int numBasic = 0;
+    for (size_t k = 0; k < numStatus; ++k) {
+        status[k] = (static_cast<unsigned char>(image[sizeof(header) + k / 2]) >> (k % 2 ? 4 : 0)) & 7;
+        if (status[k] > ClpSimplex::isFixed) {
+            return false;
+        }
+        numBasic += status[k] == ClpSimplex::basic;
+    }
+    if (numBasic != model.numberRows()) {
+        return false;
+    }
+    model.copyinStatus(status.data());
+    return true;
+}
+
+// coldSolve() (or raceSolve() with solveOptions.racers set), or a dual
+// simplex from the stored basis when there is one; an optimal result is
+// stored for the next run
+void solveWithBasisStore(ClpSimplex &model) {
+    const char *dir = solveOptions.basisDir;
+    if (dir && loadBasis(dir, model)) {
+        solverStats.basisStoreHits.fetch_add(1, memory_order_relaxed);
+        warmSolve(model, CHANGED_COSTS | CHANGED_BOUNDS);
+    } else if (solveOptions.racers > 1) {
+        raceSolve(model, solveOptions.racers);
+    } else {
+        coldSolve(model);
+    }
+    if (dir && model.isProvenOptimal()) {
+        string error;
+        if (!saveBasis(dir, model, error)) {
+            cerr << "Cannot save basis: " << error << endl;
+        }
+    }
+}
+
+
+// --- 9. PARALLEL BATCH: Worker threads with their own ClpSimplex ---
+
+// Scenario indices are handed out through one work range per worker. A range
+// is a [begin, end) pair packed into a single 64-bit atomic, so both taking
+// work and stealing it are one compare-and-swap and nothing ever blocks. The
+// owner takes small chunks off the front (consecutive scenarios, which keeps
+// its warm starts local); an idle worker steals the back half of someone
+// else's range. Indices only ever move forward through a range, so a stale
+// compare-and-swap can never succeed.
+struct alignas(64) WorkRange {
+    atomic<uint64_t> range{0};
+
+    static uint64_t pack(uint32_t begin, uint32_t end) {
+        return (static_cast<uint64_t>(begin) << 32) | end;
+    }
+
+    void assign(uint32_t begin, uint32_t end) { range.store(pack(begin, end)); }
+
+    // Takes up to `chunk` indices from the front
+    bool take(uint32_t chunk, uint32_t &begin, uint32_t &end) {
+        uint64_t current = range.load();
+        for (;;) {
+            uint32_t first = current >> 32;
+            uint32_t last = static_cast<uint32_t>(current);
+            if (first >= last) {
+                return false;
+            }
+            uint32_t split = min(first + chunk, last);
+            if (range.compare_exchange_weak(current, pack(split, last))) {
+                begin = first;
+                end = split;
+                return true;
+            }
+        }
+    }
+
+    // Takes the back half (at least one index)
+    bool steal(uint32_t &begin, uint32_t &end) {
+        uint64_t current = range.load();
+        for (;;) {
+            uint32_t first = current >> 32;
+            uint32_t last = static_cast<uint32_t>(current);
+            if (first >= last) {
+                return false;
+            }
+            uint32_t split = first + (last - first) / 2;
+            if (range.compare_exchange_weak(current, pack(first, split))) {
+                begin = split;
+                end = last;
+                return true;
+            }
+        }
+    }
+};
+
+// Runs task(0) .. task(numTasks - 1) on up to numThreads threads, handing
+// out task numbers through one atomic counter.
+template <class Task>
+void parallelFor(int numTasks, int numThreads, Task task) {
+    numThreads = min(numThreads, numTasks);
+    if (numThreads <= 1) {
+        for (int k = 0; k < numTasks; ++k) {
+            task(k);
+        }
+        return;
+    }
+    atomic<int> nextTask{0};
+    vector<thread> threads;
+    for (int w = 0; w < numThreads; ++w) {
+        threads.emplace_back([&]() {
+            for (int k = nextTask.fetch_add(1); k < numTasks; k = nextTask.fetch_add(1)) {
+                task(k);
+            }
+        });
+    }
+    for (thread &t : threads) {
+        t.join();
+    }
+}
+
+// Solves scenarios[0 .. count) into results: through the small-LP kernel
+// first when there is one, on `solver` for everything it leaves over. The
+// `solver` solves go to `archive` (if any) as scenario IDs firstId onwards.
+void solveScenarios(ScenarioSolver &solver, const SmallBlendSolver *kernel, const Scenario *scenarios,
+                    uint32_t count, ScenarioResult *results,
+                    ResultArchiveWriter *archive = nullptr, uint64_t firstId = 1) {
+    if (kernel) {
+        for (uint32_t k = 0; k < count; k += SMALL_LANES) {
+            kernel->solve(&scenarios[k], min<uint32_t>(SMALL_LANES, count - k), &results[k]);
+        }
+    }
+    for (uint32_t k = 0; k < count; ++k) {
+        if (!kernel) {
+            results[k] = solver.solve(scenarios[k]);
+        } else if (results[k].status < 0) {
+            results[k] = solver.solve(scenarios[k]);
+            solverStats.smallKernelFallbacks.fetch_add(1, memory_order_relaxed);
+        } else {
+            solverStats.smallKernelSolves.fetch_add(1, memory_order_relaxed);
+            continue;
+        }
+        if (archive) {
+            archive->write(firstId + k, solver.lastModel());
+        }
+    }
+}
+
+// Solves an in-memory scenario set on `numThreads` workers. Each worker owns
+// its ClpSimplex and arena, shares the problem read-only, and writes straight
+// into its slots of the preallocated result array. Only the per-scenario
+// summaries are kept, so NDJSON output here has no solution vectors; the
+// full solutions go to the result archive at `archivePath` if there is one,
+// filled by all workers at once. The small-LP kernel keeps no solutions, so
+// it is not used for archived runs.
+int runParallelBatch(istream &in, const BlendProblem &problem, int numThreads, bool cold,
+                     ResultWriter &writer, const char *archivePath) {
+    const uint32_t CHUNK = SMALL_LANES;
+
+    vector<Scenario> scenarios;
+    Scenario next;
+    long lineNumber = 0;
+    while (readScenario(in, problem, next, lineNumber)) {
+        scenarios.push_back(next);
+    }
+    if (scenarios.size() > UINT32_MAX) {
+        cerr << "Too many scenarios for one parallel batch" << endl;
+        return 1;
+    }
+    uint32_t numScenarios = scenarios.size();
+
+    vector<ScenarioResult> results(numScenarios);
+    vector<WorkRange> ranges(numThreads);
+    for (int w = 0; w < numThreads; ++w) {
+        ranges[w].assign(static_cast<uint64_t>(numScenarios) * w / numThreads,
+                         static_cast<uint64_t>(numScenarios) * (w + 1) / numThreads);
+    }
+    vector<long> steals(numThreads, 0);
+
+    unique_ptr<ResultArchiveWriter> archive;
+    if (archivePath) {
+        string error;
+        archive.reset(new ResultArchiveWriter);
+        if (!archive->create(archivePath, modelColumns(problem), modelRows(problem), numScenarios,
+                             error)) {
+            cerr << "Cannot write result archive: " << error << endl;
+            return 1;
+        }
+    }
+
+    unique_ptr<SmallBlendSolver> kernel;
+    if (solveOptions.smallKernel && archive) {
+        cerr << "Result archive needs full solutions, using ClpSimplex only" << endl;
+    } else if (solveOptions.smallKernel) {
+        kernel = makeSmallBlendSolver(problem);
+        if (!kernel) {
+            cerr << "Problem too large for the small-LP kernel, using ClpSimplex only" << endl;
+        }
+    }
+
+    auto worker = [&](int self) {
+        ScenarioSolver solver(problem, cold);
+        uint32_t begin, end;
+        for (;;) {
+            while (ranges[self].take(CHUNK, begin, end)) {
+                solveScenarios(solver, kernel.get(), &scenarios[begin], end - begin,
+                               &results[begin], archive.get(), begin + 1);
+            }
+            // Out of work: look for a victim, starting with the next worker
+            bool stole = false;
+            for (int v = 1; v < numThreads && !stole; ++v) {
+                stole = ranges[(self + v) % numThreads].steal(begin, end);
+            }
+            if (!stole) {
+                return;
+            }
+            ++steals[self];
+            ranges[self].assign(begin, end);
+        }
+    };
+
+    auto startTime = chrono::steady_clock::now();
+
+    vector<thread> threads;
+    for (int w = 0; w < numThreads; ++w) {
+        threads.emplace_back(worker, w);
+    }
+    for (thread &t : threads) {
+        t.join();
+    }
+
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - startTime).count();
+
+    long numOptimal = 0;
+    long totalIterations = 0;
+    for (uint32_t k = 0; k < numScenarios; ++k) {
+        numOptimal += results[k].status == 0;
+        totalIterations += results[k].iterations;
+        writer.writeSummary(k + 1, results[k]);
+    }
+    writer.flush();
+    if (!closeArchive(archive.get())) {
+        return 1;
+    }
+    long totalSteals = 0;
+    for (long count : steals) {
+        totalSteals += count;
+    }
+
+    ostream &stats = statsStream(writer.format());
+    printThroughput(stats, numScenarios, numOptimal, totalIterations, seconds, cold);
+    stats << "Workers: " << numThreads << " threads, " << totalSteals << " steals" << endl;
+    return 0;
+}
+
+// Prints one scenario of a result archive, feeds and rows named after
+// `problem` when it has the archive's shape.
+int runArchiveLookup(const char *path, uint64_t id, const BlendProblem &problem) {
+    ResultArchive archive;
+    string error;
+    if (!archive.open(path, error)) {
+        cerr << "Cannot read result archive " << path << ": " << error << endl;
+        return 1;
+    }
+    ArchivedResult result;
+    if (!archive.scenario(id, result)) {
+        cerr << "Scenario " << id << " is not in " << path << " (" << archive.numScenarios()
+             << " scenarios)" << endl;
+        return 1;
+    }
+    bool named = archive.numColumns() == modelColumns(problem) &&
+                 archive.numRows() == modelRows(problem);
+
+    cout << "Scenario " << id << "\n";
+    if (result.status != 0) {
+        cout << "Status: Not Optimal (" << result.status << ")" << endl;
+        return 0;
+    }
+    cout << "Status: Optimal\nMinimum Total Cost: $" << result.objective << "\n"
+         << "Iterations: " << result.iterations << "\n\nOptimal Feed Quantities (nonzero):\n";
+    for (uint32_t k = 0; k < result.numNonzeros; ++k) {
+        int column = result.columns[k];
+        bool known = named && column >= 0 && column < problem.numFeeds();
+        cout << "  Feed " << (known ? problem.feedNames[column] : to_string(column)) << ": "
+             << result.values[k] << " units\n";
+    }
+    cout << "\nShadow Prices:\n";
+    for (int row = 0; row < archive.numRows(); ++row) {
+        cout << "  ";
+        if (!named) {
+            cout << "Row " << row;
+        } else if (row == 0) {
+            cout << "Total Flow";
+        } else if (row <= problem.numComponents()) {
+            cout << "Component " << problem.componentNames[row - 1];
+        } else {
+            cout << "Ratio Row " << row - problem.numComponents() - 1;
+        }
+        cout << ": " << result.duals[row] << "\n";
+    }
+    cout << flush;
+    return 0;
+}
+
+
+// --- 9b. DISTRIBUTED BATCH: Scenario ranges across MPI ranks ---
+
+// runDistributedBatch() spreads one scenario file over the ranks of an MPI
+// job. Rank 0 loads the problem and broadcasts its binary image once; it
+// also indexes the scenario file, which every rank maps (so it has to be on
+// a shared file system), and broadcasts the line offsets. Each rank runs the
+// warm-start workers of runParallelBatch() on its own threads, and work
+// moves between ranks the way it moves between threads there: every rank
+// owns one packed [begin, end) range, kept in an MPI window, its threads take
+// chunks off the front, and a rank that runs dry steals the back half of
+// another rank's range with a remote compare-and-swap. Solutions stay in
+// memory on the rank that solved them until all ranks write the result
+// archive together with collective MPI-IO.
+#if BLENDER_WITH_MPI
+
+// Scenarios per take off a rank's range
+const uint32_t DISTRIBUTED_CHUNK = 64;
+// Largest single MPI transfer, well inside MPI's int counts
+const uint64_t MPI_TRANSFER_BYTES = uint64_t(1) << 30;
+
+// MPI for the lifetime of a distributed run
+class MpiSession {
+public:
+    MpiSession() {
+        MPI_Init_thread(nullptr, nullptr, MPI_THREAD_SERIALIZED, &threadLevel_);
+        MPI_Comm_rank(MPI_COMM_WORLD, &rank_);
+        MPI_Comm_size(MPI_COMM_WORLD, &size_);
+    }
+    MpiSession(const MpiSession &) = delete;
+    MpiSession &operator=(const MpiSession &) = delete;
+    ~MpiSession() { MPI_Finalize(); }
+
+    int rank() const { return rank_; }
+    int size() const { return size_; }
+    // Worker threads may call MPI, one at a time
+    bool serialized() const { return threadLevel_ >= MPI_THREAD_SERIALIZED; }
+
+private:
+    int threadLevel_ = MPI_THREAD_SINGLE;
+    int rank_ = 0;
+    int size_ = 1;
+};
+
+// True on every rank if `ok` is true on every rank
+bool allRanks(bool ok) {
+    int local = ok;
+    int all = 0;
+    MPI_Allreduce(&local, &all, 1, MPI_INT, MPI_MIN, MPI_COMM_WORLD);
+    return all != 0;
+}
+
+// MPI_Bcast() from rank 0 of any number of bytes
+void broadcast(void *data, uint64_t size) {
+    for (uint64_t done = 0; done < size; done += MPI_TRANSFER_BYTES) {
+        MPI_Bcast(static_cast<char *>(data) + done,
+                  static_cast<int>(min(size - done, MPI_TRANSFER_BYTES)), MPI_BYTE, 0,
+                  MPI_COMM_WORLD);
+    }
+}
+
+string mpiError(int code) {
+    char text[MPI_MAX_ERROR_STRING];
+    int length = 0;
+    MPI_Error_string(code, text, &length);
+    return string(text, length);
+}
+
+// The work ranges of all ranks: one uint64_t per rank, packed as in
+// WorkRange, in an MPI window that stays in a passive-target epoch for its
+// lifetime. Every access is an MPI atomic (compare-and-swap, or an
+// accumulate with MPI_REPLACE or MPI_NO_OP), so the WorkRange argument
+// carries over: a range only moves forward and a stale compare-and-swap
+// fails. The rank's worker threads share its range through next(), one at a
+// time, which is all MPI_THREAD_SERIALIZED allows.
+class DistributedRanges {
+public:
+    // Collective, like the destructor
+    DistributedRanges(const MpiSession &mpi, uint32_t begin, uint32_t end)
+        : rank_(mpi.rank()), size_(mpi.size()) {
+        MPI_Win_allocate(sizeof(uint64_t), sizeof(uint64_t), MPI_INFO_NULL, MPI_COMM_WORLD,
+                         &local_, &window_);
+        MPI_Win_lock_all(MPI_MODE_NOCHECK, window_);
+        *local_ = WorkRange::pack(begin, end);
+        MPI_Win_sync(window_);
+        MPI_Barrier(MPI_COMM_WORLD);
+    }
+    DistributedRanges(const DistributedRanges &) = delete;
+    DistributedRanges &operator=(const DistributedRanges &) = delete;
+    ~DistributedRanges() {
+        // Nobody may steal from a window that is going away
+        MPI_Barrier(MPI_COMM_WORLD);
+        MPI_Win_unlock_all(window_);
+        MPI_Win_free(&window_);
+    }
+
+    // Up to `chunk` consecutive scenarios for this rank; once its own range
+    // is empty it steals, starting with the next rank. False when no rank
+    // has anything left.
+    bool next(uint32_t chunk, uint32_t &begin, uint32_t &end) {
+        lock_guard<mutex> lock(mutex_);
+        for (;;) {
+            if (split(rank_, chunk, begin, end)) {
+                return true;
+            }
+            bool stole = false;
+            for (int v = 1; v < size_ && !stole; ++v) {
+                stole = split((rank_ + v) % size_, 0, begin, end);
+            }
+            if (!stole) {
+                return false;
+            }
+            ++steals_;
+            uint64_t range = WorkRange::pack(begin, end);
+            MPI_Accumulate(&range, 1, MPI_UINT64_T, rank_, 0, 1, MPI_UINT64_T, MPI_REPLACE,
+                           window_);
+            MPI_Win_flush(rank_, window_);
+        }
+    }
+
+    // Ranges this rank took from others
+    long steals() const { return steals_; }
+
+private:
+    // Takes `chunk` indices off the front of `target`'s range, or with
+    // `chunk` 0 the back half (at least one index)
+    bool split(int target, uint32_t chunk, uint32_t &begin, uint32_t &end) {
+        uint64_t current = 0;
+        uint64_t unused = 0;
+        MPI_Fetch_and_op(&unused, &current, MPI_UINT64_T, target, 0, MPI_NO_OP, window_);
+        MPI_Win_flush(target, window_);
+        for (;;) {
+            uint32_t first = current >> 32;
+            uint32_t last = static_cast<uint32_t>(current);
+            if (first >= last) {
+                return false;
+            }
+            uint32_t cut = chunk > 0 ? min(first + chunk, last) : first + (last - first) / 2;
+            uint64_t desired = chunk > 0 ? WorkRange::pack(cut, last) : WorkRange::pack(first, cut);
+            uint64_t seen = 0;
+            MPI_Compare_and_swap(&desired, &current, &seen, MPI_UINT64_T, target, 0, window_);
+            MPI_Win_flush(target, window_);
+            if (seen == current) {
+                begin = chunk > 0 ? first : cut;
+                end = chunk > 0 ? cut : last;
+                return true;
+            }
+            current = seen;
+        }
+    }
+
+    int rank_;
+    int size_;
+    uint64_t *local_ = nullptr;
+    MPI_Win window_;
+    mutex mutex_;
+    long steals_ = 0;
+};
+
+// What one worker thread solved. `blocks` holds the archive blocks of its
+// scenarios, and the entries point into it until the archive is written.
+struct DistributedShard {
+    vector<char> blocks;
+    vector<pair<uint64_t, ArchiveEntry>> entries;  // scenario ID, entry
+    long numScenarios = 0;
+    long numOptimal = 0;
+    long totalIterations = 0;
+};
+
+// Writes the shards of all ranks as one result archive, in the layout of a
+// ResultArchiveWriter with a capacity. Collective: the blocks of a rank go
+// behind those of the ranks before it, each rank writes its part of the
+// index through a file view of just its entries, and rank 0 writes the
+// header once everything else is on disk.
+bool writeDistributedArchive(const char *path, const BlendProblem &problem, uint64_t numScenarios,
+                             vector<DistributedShard> &shards, int rank, string &error) {
+    ArchiveHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, ARCHIVE_MAGIC, sizeof(header.magic));
+    header.numScenarios = numScenarios;
+    header.indexOffset = sizeof(header);
+    header.numColumns = modelColumns(problem);
+    header.numRows = modelRows(problem);
+    uint64_t dataOffset = sizeof(header) + numScenarios * sizeof(ArchiveEntry);
+
+    uint64_t localBytes = 0;
+    for (const DistributedShard &shard : shards) {
+        localBytes += shard.blocks.size();
+    }
+    uint64_t before = 0;
+    uint64_t totalBytes = 0;
+    MPI_Exscan(&localBytes, &before, 1, MPI_UINT64_T, MPI_SUM, MPI_COMM_WORLD);
+    if (rank == 0) {
+        before = 0;  // MPI_Exscan() leaves it undefined
+    }
+    MPI_Allreduce(&localBytes, &totalBytes, 1, MPI_UINT64_T, MPI_SUM, MPI_COMM_WORLD);
+
+    // This rank's blocks, cut into transfers, and its index entries in ID
+    // order with the file offsets of their blocks
+    struct Piece {
+        uint64_t offset;
+        const char *data;
+        int size;
+    };
+    vector<Piece> pieces;
+    vector<pair<uint64_t, ArchiveEntry>> entries;
+    uint64_t offset = dataOffset + before;
+    for (DistributedShard &shard : shards) {
+        uint64_t size = shard.blocks.size();
+        for (uint64_t done = 0; done < size; done += MPI_TRANSFER_BYTES) {
+            pieces.push_back({offset + done, shard.blocks.data() + done,
+                              static_cast<int>(min(size - done, MPI_TRANSFER_BYTES))});
+        }
+        for (pair<uint64_t, ArchiveEntry> &entry : shard.entries) {
+            entry.second.offset += offset;
+            entries.push_back(entry);
+        }
+        offset += shard.blocks.size();
+    }
+    sort(entries.begin(), entries.end(),
+         [](const pair<uint64_t, ArchiveEntry> &a, const pair<uint64_t, ArchiveEntry> &b) {
+             return a.first < b.first;
+         });
+
+    MPI_File file;
+    int code = MPI_File_open(MPI_COMM_WORLD, path, MPI_MODE_CREATE | MPI_MODE_WRONLY,
+                             MPI_INFO_NULL, &file);
+    if (!allRanks(code == MPI_SUCCESS)) {
+        error = string("cannot create ") + path + ": " +
+                (code == MPI_SUCCESS ? string("failed on another rank") : mpiError(code));
+        if (code == MPI_SUCCESS) {
+            MPI_File_close(&file);
+        }
+        return false;
+    }
+    // Every rank makes every collective call from here on; the first error
+    // is kept
+    auto check = [&](int code) {
+        if (code != MPI_SUCCESS && error.empty()) {
+            error = "write failed: " + mpiError(code);
+        }
+    };
+    check(MPI_File_set_size(file, dataOffset + totalBytes));  // drops an older file's tail
+
+    uint64_t numRounds = 0;
+    uint64_t numPieces = pieces.size();
+    MPI_Allreduce(&numPieces, &numRounds, 1, MPI_UINT64_T, MPI_MAX, MPI_COMM_WORLD);
+    for (uint64_t round = 0; round < numRounds; ++round) {
+        Piece piece = round < numPieces ? pieces[round] : Piece{0, nullptr, 0};
+        check(MPI_File_write_at_all(file, piece.offset, piece.data, piece.size, MPI_BYTE,
+                                    MPI_STATUS_IGNORE));
+    }
+
+    // The index through a view that shows this rank only its entries' slots
+    vector<ArchiveEntry> index;
+    vector<int> runLengths;
+    vector<MPI_Aint> runOffsets;
+    for (size_t k = 0; k < entries.size(); ++k) {
+        if (k > 0 && entries[k].first == entries[k - 1].first + 1) {
+            ++runLengths.back();
+        } else {
+            runLengths.push_back(1);
+            runOffsets.push_back((entries[k].first - 1) * sizeof(ArchiveEntry));
+        }
+        index.push_back(entries[k].second);
+    }
+    MPI_Datatype entryType;
+    MPI_Datatype slotsType;
+    MPI_Type_contiguous(sizeof(ArchiveEntry), MPI_BYTE, &entryType);
+    MPI_Type_commit(&entryType);
+    MPI_Type_create_hindexed(runLengths.size(), runLengths.data(), runOffsets.data(), entryType,
+                             &slotsType);
+    MPI_Type_commit(&slotsType);
+    check(MPI_File_set_view(file, sizeof(header), entryType, slotsType, "native", MPI_INFO_NULL));
+    check(MPI_File_write_all(file, index.data(), index.size(), entryType, MPI_STATUS_IGNORE));
+    check(MPI_File_set_view(file, 0, MPI_BYTE, MPI_BYTE, "native", MPI_INFO_NULL));
+    MPI_Type_free(&slotsType);
+    MPI_Type_free(&entryType);
+
+    check(MPI_File_sync(file));
+    MPI_Barrier(MPI_COMM_WORLD);
+    if (rank == 0) {
+        check(MPI_File_write_at(file, 0, &header, sizeof(header), MPI_BYTE, MPI_STATUS_IGNORE));
+    }
+    check(MPI_File_close(&file));
+    if (!allRanks(error.empty())) {
+        if (error.empty()) {
+            error = "write failed on another rank";
+        }
+        return false;
+    }
+    return true;
+}
+
+// A scenario file mapped read-only on every rank
+class MappedText {
+public:
+    MappedText() = default;
+    MappedText(const MappedText &) = delete;
+    MappedText &operator=(const MappedText &) = delete;
+    ~MappedText() {
+        if (base_) {
+            munmap(base_, size_);
+        }
+    }
+
+    bool open(const char *path, string &error) {
+        int fd = ::open(path, O_RDONLY);
+        struct stat info;
+        if (fd < 0 || fstat(fd, &info) != 0) {
+            error = strerror(errno);
+            if (fd >= 0) {
+                ::close(fd);
+            }
+            return false;
+        }
+        size_ = info.st_size;
+        void *mapped = size_ > 0 ? mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0) : nullptr;
+        ::close(fd);
+        if (mapped == MAP_FAILED) {
+            error = string("mmap failed: ") + strerror(errno);
+            return false;
+        }
+        base_ = static_cast<char *>(mapped);
+        return true;
+    }
+
+    const char *begin() const { return base_; }
+    const char *end() const { return base_ + size_; }
+
+    // The end of the line starting at `line`
+    const char *lineEnd(const char *line) const {
+        const char *newline = static_cast<const char *>(memchr(line, '\n', end() - line));
+        return newline ? newline : end();
+    }
+
+private:
+    char *base_ = nullptr;
+    size_t size_ = 0;
+};
+
+// One rank's share of a distributed batch, gathered on rank 0
+struct RankReport {
+    double seconds;  // until its last worker ran out of scenarios
+    int64_t numThreads;
+    int64_t numScenarios;
+    int64_t numOptimal;
+    int64_t totalIterations;
+    int64_t steals;  // ranges taken from other ranks
+    uint64_t peakRssBytes;
+};
+
+// The per-rank throughput and the load imbalance: how much longer than the
+// mean the slowest rank took
+void printRankReports(ostream &out, const vector<RankReport> &reports, bool cold) {
+    long numScenarios = 0, numOptimal = 0, totalIterations = 0, numThreads = 0, steals = 0;
+    double slowest = 0.0, meanSeconds = 0.0;
+    size_t slowestRank = 0;
+    for (size_t r = 0; r < reports.size(); ++r) {
+        const RankReport &report = reports[r];
+        numScenarios += report.numScenarios;
+        numOptimal += report.numOptimal;
+        totalIterations += report.totalIterations;
+        numThreads += report.numThreads;
+        steals += report.steals;
+        meanSeconds += report.seconds / reports.size();
+        if (report.seconds > slowest) {
+            slowest = report.seconds;
+            slowestRank = r;
+        }
+    }
+    printThroughput(out, numScenarios, numOptimal, totalIterations, slowest, cold);
+    out << "Ranks: " << reports.size() << " (" << numThreads << " worker threads), " << steals
+        << " ranges moved between ranks" << endl;
+    for (size_t r = 0; r < reports.size(); ++r) {
+        const RankReport &report = reports[r];
+        out << "  Rank " << r << ": " << report.numScenarios << " scenarios in " << report.seconds
+            << " s (" << (report.seconds > 0.0 ? report.numScenarios / report.seconds : 0.0)
+            << " scenarios/s), " << report.steals << " steals, peak RSS "
+            << report.peakRssBytes / double(1 << 20) << " MB" << endl;
+    }
+    out << "Load imbalance: " << (meanSeconds > 0.0 ? (slowest / meanSeconds - 1.0) * 100.0 : 0.0)
+        << "% (slowest rank " << slowestRank << " " << slowest << " s, mean " << meanSeconds
+        << " s)" << endl;
+}
+
+// The distributed batch (see above), run on every rank of the job with the
+// same arguments; `numThreads` 0 is one per hardware thread of the rank's
+// node. Only rank 0 loads `dataFile` and writes `statsFile` (its own
+// counters). Per-scenario results go only to the archive at `archivePath`.
+int runDistributedBatch(const char *dataFile, double dropTolerance, const char *scenarioFile,
+                        int numThreads, bool cold, const char *archivePath,
+                        const char *statsFile) {
+    MpiSession mpi;
+    StatsFileWriter statsWriter(mpi.rank() == 0 ? statsFile : nullptr);
+    bool root = mpi.rank() == 0;
+    if (numThreads <= 0) {
+        numThreads = max(1u, thread::hardware_concurrency());
+    }
+    unique_ptr<SolveCache> cache;  // behind resultCache
+    if (solveOptions.resultCacheBytes > 0) {
+        cache.reset(new SolveCache(solveOptions.resultCacheBytes, solveOptions.compactResults));
+        resultCache = cache.get();
+    }
+
+    BlendProblem problem;
+    vector<char> image;
+    string error;
+    if (root) {
+        if (dataFile && !loadProblemFile(dataFile, problem, error)) {
+            cerr << "Cannot load " << dataFile << ": " << error << endl;
+        } else {
+            if (!dataFile) {
+                problem = exampleProblem();
+            }
+            binaryProblemImage(problem, image);
+        }
+    }
+    uint64_t imageBytes = image.size();
+    broadcast(&imageBytes, sizeof(imageBytes));
+    if (imageBytes == 0) {
+        return 1;
+    }
+    image.resize(imageBytes);
+    broadcast(image.data(), imageBytes);
+    if (!root && !loadBinaryImage(image.data(), image.size(), problem, error)) {
+        cerr << "Rank " << mpi.rank() << " cannot read the problem: " << error << endl;
+    }
+    if (!allRanks(error.empty())) {
+        return 1;
+    }
+    problem.dropTolerance = dropTolerance;
+    if (resultCache && solveOptions.compactResults) {
+        problem.narrowContent();
+    }
+
+    MappedText text;
+    if (!text.open(scenarioFile, error)) {
+        cerr << "Rank " << mpi.rank() << " cannot open scenario file " << scenarioFile << ": "
+             << error << endl;
+    }
+    if (!allRanks(error.empty())) {
+        return 1;
+    }
+    vector<uint64_t> lineStarts;  // one per good scenario line
+    if (root) {
+        Scenario scenario;
+        long lineNumber = 0;
+        for (const char *line = text.begin(); line < text.end();) {
+            const char *lineEnd = text.lineEnd(line);
+            ++lineNumber;
+            const char *first = line;
+            while (first < lineEnd && (*first == ' ' || *first == '\t' || *first == '\r')) {
+                ++first;
+            }
+            if (first < lineEnd && *first != '#') {
+                if (parseScenarioLine(line, lineEnd, problem, scenario)) {
+                    lineStarts.push_back(line - text.begin());
+                } else {
+                    cerr << "Skipping malformed scenario on line " << lineNumber << endl;
+                }
+            }
+            line = lineEnd < text.end() ? lineEnd + 1 : lineEnd;
+        }
+    }
+    uint64_t numScenarios = lineStarts.size();
+    broadcast(&numScenarios, sizeof(numScenarios));
+    if (numScenarios > INT_MAX) {
+        if (root) {
+            cerr << "Too many scenarios for one distributed batch" << endl;
+        }
+        return 1;
+    }
+    lineStarts.resize(numScenarios);
+    broadcast(lineStarts.data(), numScenarios * sizeof(uint64_t));
+
+    unique_ptr<SmallBlendSolver> kernel;
+    if (solveOptions.smallKernel && archivePath) {
+        if (root) {
+            cerr << "Result archive needs full solutions, using ClpSimplex only" << endl;
+        }
+    } else if (solveOptions.smallKernel) {
+        kernel = makeSmallBlendSolver(problem);
+        if (!kernel && root) {
+            cerr << "Problem too large for the small-LP kernel, using ClpSimplex only" << endl;
+        }
+    }
+    if (numThreads > 1 && !mpi.serialized()) {
+        if (root) {
+            cerr << "MPI library has no MPI_THREAD_SERIALIZED, using one thread per rank" << endl;
+        }
+        numThreads = 1;
+    }
+
+    vector<DistributedShard> shards(numThreads);
+    RankReport report = {};
+    {
+        DistributedRanges ranges(mpi, numScenarios * mpi.rank() / mpi.size(),
+                                 numScenarios * (mpi.rank() + 1) / mpi.size());
+        auto worker = [&](int self) {
+            ScenarioSolver solver(problem, cold);
+            DistributedShard &shard = shards[self];
+            vector<Scenario> batch(DISTRIBUTED_CHUNK);
+            vector<ScenarioResult> results(DISTRIBUTED_CHUNK);
+            uint32_t begin, end;
+            while (ranges.next(DISTRIBUTED_CHUNK, begin, end)) {
+                uint32_t count = end - begin;
+                for (uint32_t k = 0; k < count; ++k) {
+                    const char *line = text.begin() + lineStarts[begin + k];
+                    parseScenarioLine(line, text.lineEnd(line), problem, batch[k]);
+                }
+                if (archivePath) {
+                    for (uint32_t k = 0; k < count; ++k) {
+                        results[k] = solver.solve(batch[k]);
+                        ArchiveEntry entry;
+                        appendArchiveBlock(solver.lastModel(), shard.blocks, entry);
+                        shard.entries.emplace_back(begin + k + 1, entry);
+                    }
+                } else {
+                    solveScenarios(solver, kernel.get(), batch.data(), count, results.data());
+                }
+                for (uint32_t k = 0; k < count; ++k) {
+                    ++shard.numScenarios;
+                    shard.numOptimal += results[k].status == 0;
+                    shard.totalIterations += results[k].iterations;
+                }
+            }
+        };
+
+        auto startTime = chrono::steady_clock::now();
+        if (numThreads == 1) {
+            worker(0);
+        } else {
+            vector<thread> threads;
+            for (int w = 0; w < numThreads; ++w) {
+                threads.emplace_back(worker, w);
+            }
+            for (thread &t : threads) {
+                t.join();
+            }
+        }
+        report.seconds = chrono::duration<double>(chrono::steady_clock::now() - startTime).count();
+        report.steals = ranges.steals();
+    }
+    report.numThreads = numThreads;
+    for (const DistributedShard &shard : shards) {
+        report.numScenarios += shard.numScenarios;
+        report.numOptimal += shard.numOptimal;
+        report.totalIterations += shard.totalIterations;
+    }
+
+    bool archived = true;
+    double archiveSeconds = 0.0;
+    if (archivePath) {
+        auto startTime = chrono::steady_clock::now();
+        archived = writeDistributedArchive(archivePath, problem, numScenarios, shards, mpi.rank(),
+                                           error);
+        archiveSeconds = chrono::duration<double>(chrono::steady_clock::now() - startTime).count();
+        if (!archived && root) {
+            cerr << "Cannot write result archive: " << error << endl;
+        }
+    }
+    report.peakRssBytes = peakRssBytes();
+
+    vector<RankReport> reports(root ? mpi.size() : 0);
+    MPI_Gather(&report, sizeof(report), MPI_BYTE, reports.data(), sizeof(report), MPI_BYTE, 0,
+               MPI_COMM_WORLD);
+    if (root) {
+        printRankReports(cout, reports, cold);
+        if (archivePath && archived) {
+            cout << "Result archive: " << numScenarios << " scenarios written to " << archivePath
+                 << " in " << archiveSeconds << " s" << endl;
+        }
+    }
+    return archived ? 0 : 1;
+}
+
+#endif
+
+
+// --- 10. LIVE MODEL: Incremental updates on a solved model ---
+
+// Owns a problem and its live ClpSimplex. Every setter patches the model in
+// place (objective coefficient, row bounds, or one column) and the next
+// resolve() re-optimizes from the current basis, choosing the algorithm the
+// same way batch mode does. Setters that change nothing are free.
+class Blender {
+public:
+    explicit Blender(const BlendProblem &problem) : problem_(problem) {
+        buildModel(model_, problem_, arena_);
+        model_.setLogLevel(0);
+    }
+
+    const BlendProblem &problem() const { return problem_; }
+    ClpSimplex &model() { return model_; }
+
+    void setFeedCost(int feed, double cost) {
+        if (problem_.cost[feed] != cost) {
+            problem_.cost[feed] = cost;
+            model_.setObjectiveCoefficient(feed, cost);
+            changed_ |= CHANGED_COSTS;
+        }
+    }
+
+    // `fraction` is the minimum content, as in BlendProblem::reqMin
+    void setSpecMin(int component, double fraction) {
+        if (problem_.reqMin[component] != fraction) {
+            problem_.reqMin[component] = fraction;
+            model_.setRowLower(component + 1, fraction * problem_.totalBlend);
+            changed_ |= CHANGED_BOUNDS;
+        }
+    }
+
+    // `fraction` is the maximum content, 1.0e+20 for none
+    void setSpecMax(int component, double fraction) {
+        if (problem_.reqMax[component] != fraction) {
+            problem_.reqMax[component] = fraction;
+            model_.setRowUpper(component + 1, perBlend(fraction, problem_.totalBlend));
+            changed_ |= CHANGED_BOUNDS;
+        }
+    }
+
+    // Units of the feed on hand, 1.0e+20 for unlimited
+    void setAvailable(int feed, double units) {
+        if (problem_.available[feed] != units) {
+            problem_.available[feed] = units;
+            model_.setColumnUpper(feed, units);
+            changed_ |= CHANGED_BOUNDS;
+        }
+    }
+
+    // The specs and share-of-blend ratios are fractions of the total, so
+    // their rows move with it
+    void setTotalBlend(double total) {
+        if (problem_.totalBlend != total) {
+            problem_.totalBlend = total;
+            model_.setRowBounds(0, total, total);
+            for (int j = 0; j < problem_.numComponents(); ++j) {
+                model_.setRowBounds(j + 1, problem_.reqMin[j] * total,
+                                    perBlend(problem_.reqMax[j], total));
+            }
+            vector<RatioRow> rows;
+            ratioRows(problem_.view(), rows);
+            for (size_t r = 0; r < rows.size(); ++r) {
+                if (rows[r].share) {
+                    model_.setRowBounds(problem_.numComponents() + 1 + r,
+                                        perBlend(rows[r].lower, total),
+                                        perBlend(rows[r].upper, total));
+                }
+            }
+            changed_ |= CHANGED_BOUNDS;
+        }
+    }
+
+    // Adds a feed as a new column at its lower bound (0), which keeps the
+    // current basis primal feasible. It is unlimited and in no ratio limit
+    // (share-of-blend limits count it through the total). Returns the new
+    // feed ID.
+    int addFeed(const string &name, double cost, const vector<pair<int, double>> &content) {
+        if (problem_.feedIds.count(name)) {
+            return -1;
+        }
+        int feed = problem_.internFeed(name);
+        problem_.cost[feed] = cost;
+        for (const pair<int, double> &entry : content) {
+            problem_.setContent(feed, entry.first, entry.second);
+        }
+
+        // Column: total flow plus the stored (nonzero) content
+        vector<int> rows(1, 0);
+        vector<double> elements(1, 1.0);
+        for (int k = problem_.contentStart[feed]; k < problem_.contentStart[feed + 1]; ++k) {
+            rows.push_back(problem_.contentComponent[k] + 1);
+            elements.push_back(problem_.fraction(k));
+        }
+        model_.addColumn(rows.size(), rows.data(), elements.data(), 0.0, 1.0e+20, cost);
+        model_.setColumnStatus(feed, ClpSimplex::atLowerBound);
+        changed_ |= CHANGED_COSTS;
+        return feed;
+    }
+
+    // Removes a feed; higher feed IDs move down by one. The other columns
+    // keep their status, so resolve() goes on with a (warm) primal pass from
+    // what is left of the basis. This is needed even for a nonbasic feed,
+    // which can sit at its availability with a positive quantity.
+    void removeFeed(int feed) {
+        changed_ |= CHANGED_STRUCTURE;
+        model_.deleteColumns(1, &feed);
+        problem_.removeFeed(feed);
+    }
+
+    // Re-optimizes after the pending changes and returns ClpSimplex::status().
+    // Only the first call solves cold: deleteColumns() resets the problem
+    // status, so isProvenOptimal() would send every removal to coldSolve().
+    int resolve() {
+        auto startTime = chrono::steady_clock::now();
+        if (!solved_) {
+            coldSolve(model_);
+        } else {
+            warmSolve(model_, changed_);
+        }
+        changed_ = CHANGED_NOTHING;
+        solved_ = true;
+        lastSolveSeconds_ = chrono::duration<double>(chrono::steady_clock::now() - startTime).count();
+        return model_.status();
+    }
+
+    double lastSolveSeconds() const { return lastSolveSeconds_; }
+
+private:
+    BlendProblem problem_;
+    BuildArena arena_;
+    ClpSimplex model_;
+    int changed_ = CHANGED_NOTHING;
+    bool solved_ = false;
+    double lastSolveSeconds_ = 0.0;
+};
+
+// Interactive updates on stdin (one command per line), each followed by a
+// re-solve from the current basis:
+//   cost <feed> <value>      spec <component> <min fraction>     total <value>
+//   max <component> <max fraction>                               avail <feed> <units>
+//   add <feed> <cost> [<component>=<fraction> ...]               remove <feed>
+int runLive(const BlendProblem &problem) {
+    Blender blender(problem);
+    blender.resolve();
+
+    string line;
+    while (getline(cin, line)) {
+        istringstream fields(line);
+        string command, name;
+        double value;
+        if (!(fields >> command) || command[0] == '#') {
+            continue;
+        }
+
+        const BlendProblem &data = blender.problem();
+        auto feedId = [&](const string &feed) {
+            auto found = data.feedIds.find(feed);
+            return found == data.feedIds.end() ? -1 : found->second;
+        };
+        auto componentId = [&](const string &component) {
+            auto found = data.componentIds.find(component);
+            return found == data.componentIds.end() ? -1 : found->second;
+        };
+
+        bool ok = false;
+        if (command == "cost" && fields >> name >> value && feedId(name) >= 0) {
+            blender.setFeedCost(feedId(name), value);
+            ok = true;
+        } else if (command == "spec" && fields >> name >> value && componentId(name) >= 0) {
+            blender.setSpecMin(componentId(name), value);
+            ok = true;
+        } else if (command == "max" && fields >> name >> value && componentId(name) >= 0) {
+            blender.setSpecMax(componentId(name), value);
+            ok = true;
+        } else if (command == "avail" && fields >> name >> value && feedId(name) >= 0) {
+            blender.setAvailable(feedId(name), value);
+            ok = true;
+        } else if (command == "total" && fields >> value) {
+            blender.setTotalBlend(value);
+            ok = true;
+        } else if (command == "add" && fields >> name >> value) {
+            vector<pair<int, double>> content;
+            string entry;
+            ok = true;
+            while (ok && fields >> entry) {
+                size_t equals = entry.find('=');
+                int component = equals == string::npos ? -1 : componentId(entry.substr(0, equals));
+                ok = component >= 0;
+                if (ok) {
+                    content.emplace_back(component, atof(entry.c_str() + equals + 1));
+                }
+            }
+            ok = ok && blender.addFeed(name, value, content) >= 0;
+        } else if (command == "remove" && fields >> name && feedId(name) >= 0) {
+            blender.removeFeed(feedId(name));
+            ok = true;
+        }
+        if (!ok) {
+            cerr << "Cannot apply: " << line << endl;
+            continue;
+        }
+
+        int status = blender.resolve();
+        if (status == 0) {
+            cout << "Optimal " << blender.model().getObjValue();
+        } else {
+            cout << "Not Optimal (" << status << ")";
+        }
+        cout << " in " << blender.lastSolveSeconds() * 1.0e6 << " us ("
+             << blender.model().numberIterations() << " iterations)" << endl;
+    }
+    return 0;
+}
+
+
+// --- 11. BENCHMARK: Synthetic instances and per-phase timings ---
+
+// Shape of a synthetic benchmark instance, set with
+//   --bench feeds=4000,components=300,density=0.1,scenarios=1000,repeats=5,seed=1
+struct BenchOptions {
+    int feeds = 1000;
+    int components = 50;
+    double density = 0.2;   // fraction of (feed, component) contents that are nonzero
+    int scenarios = 200;    // warm re-solves, each with perturbed prices and specs
+    int repeats = 5;        // samples of the load, build and cold solve phases
+    unsigned long seed = 1;
+};
+
+bool parseBenchOptions(const char *text, BenchOptions &options) {
+    string spec(text);
+    size_t begin = 0;
+    while (begin < spec.size()) {
+        size_t end = spec.find(',', begin);
+        if (end == string::npos) {
+            end = spec.size();
+        }
+        string entry = spec.substr(begin, end - begin);
+        size_t equals = entry.find('=');
+        if (equals == string::npos) {
+            return false;
+        }
+        string key = entry.substr(0, equals);
+        const char *value = entry.c_str() + equals + 1;
+        if (key == "feeds") {
+            options.feeds = atoi(value);
+        } else if (key == "components") {
+            options.components = atoi(value);
+        } else if (key == "density") {
+            options.density = atof(value);
+        } else if (key == "scenarios") {
+            options.scenarios = atoi(value);
+        } else if (key == "repeats") {
+            options.repeats = atoi(value);
+        } else if (key == "seed") {
+            options.seed = strtoul(value, nullptr, 10);
+        } else {
+            return false;
+        }
+        begin = end + 1;
+    }
+    return options.feeds > 0 && options.components > 0 && options.density >= 0.0 &&
+           options.density <= 1.0 && options.scenarios >= 0 && options.repeats > 0;
+}
+
+// A random instance that is feasible by construction: the specs are set to
+// 80% of what an even mix of all feeds achieves, so that mix always
+// satisfies them (also after perturbScenario raises them by up to 5%).
+BlendProblem generateProblem(const BenchOptions &options, mt19937_64 &random) {
+    uniform_real_distribution<double> unit(0.0, 1.0);
+    BlendProblem problem;
+    for (int j = 0; j < options.components; ++j) {
+        problem.internComponent("q" + to_string(j));
+    }
+    vector<double> evenMix(options.components, 0.0);
+    for (int i = 0; i < options.feeds; ++i) {
+        int feed = problem.internFeed("f" + to_string(i));
+        problem.cost[feed] = 5.0 + 15.0 * unit(random);
+        for (int j = 0; j < options.components; ++j) {
+            if (unit(random) < options.density) {
+                double fraction = 0.01 + 0.99 * unit(random);
+                problem.setContent(feed, j, fraction);
+                evenMix[j] += fraction / options.feeds;
+            }
+        }
+    }
+    for (int j = 0; j < options.components; ++j) {
+        problem.reqMin[j] = 0.8 * evenMix[j];
+    }
+    problem.totalBlend = 100.0;
+    return problem;
+}
+
+// Prices move by up to +-10%, specs by up to +-5%
+Scenario perturbScenario(const Scenario &base, mt19937_64 &random) {
+    uniform_real_distribution<double> price(0.9, 1.1);
+    uniform_real_distribution<double> spec(0.95, 1.05);
+    Scenario scenario = base;
+    for (double &cost : scenario.costs) {
+        cost *= price(random);
+    }
+    for (double &fraction : scenario.reqMin) {
+        fraction *= spec(random);
+    }
+    return scenario;
+}
+
+// Nearest-rank percentiles of a sample set
+struct Percentiles {
+    size_t count = 0;
+    double mean = 0.0, p50 = 0.0, p90 = 0.0, p99 = 0.0, max = 0.0;
+};
+
+Percentiles percentiles(vector<double> samples) {
+    Percentiles result;
+    result.count = samples.size();
+    if (samples.empty()) {
+        return result;
+    }
+    sort(samples.begin(), samples.end());
+    auto rank = [&](double p) {
+        size_t index = static_cast<size_t>(ceil(p * samples.size()));
+        return samples[min(max<size_t>(index, 1), samples.size()) - 1];
+    };
+    for (double sample : samples) {
+        result.mean += sample / samples.size();
+    }
+    result.p50 = rank(0.50);
+    result.p90 = rank(0.90);
+    result.p99 = rank(0.99);
+    result.max = samples.back();
+    return result;
+}
+
+void writePercentilesJson(ostream &out, const char *name, const vector<double> &samples,
+                          bool last = false) {
+    Percentiles p = percentiles(samples);
+    out << "    \"" << name << "\": {\"samples\": " << p.count << ", \"mean\": " << p.mean
+        << ", \"p50\": " << p.p50 << ", \"p90\": " << p.p90 << ", \"p99\": " << p.p99
+        << ", \"max\": " << p.max << "}" << (last ? "\n" : ",\n");
+}
+
+// Times the phases of the blend pipeline on a synthetic instance and writes
+// a JSON report (seconds; iteration counts from numberIterations()):
+//   load     - CSV file -> BlendProblem (loadProblemFile)
+//   build    - BlendProblem -> ClpSimplex (buildModel)
+//   initial  - cold solve (presolve and dual simplex, see coldSolve)
+//   warm     - re-solve of a perturbed scenario from the previous basis
+//   output   - NDJSON record of one solution, duals and reduced costs
+int runBenchmark(const BenchOptions &options, const char *reportFile, double dropTolerance) {
+    mt19937_64 random(options.seed);
+    BlendProblem generated = generateProblem(options, random);
+    generated.dropTolerance = dropTolerance;
+
+    // The load phase reads the instance back from a CSV file
+    char csvPath[] = "/tmp/lp_blender_bench_XXXXXX";
+    int fd = mkstemp(csvPath);
+    if (fd < 0) {
+        cerr << "Cannot create a temporary file: " << strerror(errno) << endl;
+        return 1;
+    }
+    close(fd);
+    string error;
+    if (!writeCsvProblem(csvPath, generated, error)) {
+        cerr << "Cannot write benchmark data: " << error << endl;
+        unlink(csvPath);
+        return 1;
+    }
+
+    vector<double> loadTimes, buildTimes, initialTimes, warmTimes, outputTimes;
+    vector<double> initialIterations, warmIterations;
+    auto seconds = [](chrono::steady_clock::time_point since) {
+        return chrono::duration<double>(chrono::steady_clock::now() - since).count();
+    };
+
+    BlendProblem problem;
+    for (int r = 0; r < options.repeats; ++r) {
+        BlendProblem loaded;
+        loaded.dropTolerance = dropTolerance;
+        auto start = chrono::steady_clock::now();
+        if (!loadProblemFile(csvPath, loaded, error)) {
+            cerr << "Cannot load benchmark data: " << error << endl;
+            unlink(csvPath);
+            return 1;
+        }
+        loadTimes.push_back(seconds(start));
+        problem = move(loaded);
+    }
+    unlink(csvPath);
+
+    BuildArena arena;
+    for (int r = 0; r < options.repeats; ++r) {
+        ClpSimplex model;
+        model.setLogLevel(0);
+        auto start = chrono::steady_clock::now();
+        buildModel(model, problem, arena);
+        buildTimes.push_back(seconds(start));
+
+        start = chrono::steady_clock::now();
+        coldSolve(model);
+        initialTimes.push_back(seconds(start));
+        initialIterations.push_back(model.numberIterations());
+    }
+
+    // Warm re-solves and output on one live model, as in batch mode
+    int outputFd = open("/dev/null", O_WRONLY);
+    ResultWriter writer(OUTPUT_NDJSON, outputFd);
+    ScenarioSolver solver(problem, false);
+    Scenario base = baseScenario(problem);
+    solver.solve(base);
+    long numOptimal = 0;
+    for (int s = 0; s < options.scenarios; ++s) {
+        Scenario next = perturbScenario(base, random);
+        auto start = chrono::steady_clock::now();
+        ScenarioResult result = solver.solve(next);
+        warmTimes.push_back(seconds(start));
+        warmIterations.push_back(result.iterations);
+        numOptimal += result.status == 0;
+
+        start = chrono::steady_clock::now();
+        writer.writeSolution(s + 1, solver.lastModel(), problem);
+        writer.flush();
+        outputTimes.push_back(seconds(start));
+    }
+    close(outputFd);
+
+    ofstream file;
+    if (reportFile) {
+        file.open(reportFile);
+        if (!file) {
+            cerr << "Cannot create " << reportFile << endl;
+            return 1;
+        }
+    }
+    ostream &out = reportFile ? static_cast<ostream &>(file) : cout;
+    out.precision(9);
+    out << "{\n  \"instance\": {\"feeds\": " << options.feeds << ", \"components\": "
+        << options.components << ", \"density\": " << options.density
+        << ", \"scenarios\": " << options.scenarios << ", \"repeats\": " << options.repeats
+        << ", \"seed\": " << options.seed << ", \"nonzeros\": "
+        << problem.numFeeds() + problem.numContent() << "},\n";
+    out << "  \"seconds\": {\n";
+    writePercentilesJson(out, "load", loadTimes);
+    writePercentilesJson(out, "build", buildTimes);
+    writePercentilesJson(out, "initial", initialTimes);
+    writePercentilesJson(out, "warm", warmTimes);
+    writePercentilesJson(out, "output", outputTimes, true);
+    out << "  },\n  \"iterations\": {\n";
+    writePercentilesJson(out, "initial", initialIterations);
+    writePercentilesJson(out, "warm", warmIterations, true);
+    out << "  },\n  \"optimal_scenarios\": " << numOptimal << "\n}" << endl;
+    return 0;
+}
+
+
+// --- 12. SENSITIVITY: Parametric cost curves and ranging ---
+
+// Traces the optimal total cost as `feed`'s price moves from `low` to
+// `high`. dualRanging() gives how far the price can rise before the optimal
+// basis changes; the curve is linear up to there, so one warm re-solve just
+// past each breakpoint replaces a full solve per sampled price. `model` must
+// be solved; the feed's cost is restored (and re-solved) at the end.
+vector<CostSegment> costCurve(ClpSimplex &model, int feed, double low, double high) {
+    const int MAX_STEPS = 100000;
+    const double originalCost = model.getObjCoefficients()[feed];
+    vector<CostSegment> segments;
+
+    model.setObjectiveCoefficient(feed, low);
+    warmSolve(model, CHANGED_COSTS);
+
+    double price = low;       // start of the segment being traced
+    double solvedAt = low;    // price the model is currently solved at
+    double nudge = 1.0e-9 * max(1.0, fabs(low));
+    for (int step = 0; step < MAX_STEPS && model.isProvenOptimal(); ++step) {
+        double increase, decrease;
+        int sequenceIncrease, sequenceDecrease;
+        if (model.dualRanging(1, &feed, &increase, &sequenceIncrease, &decrease,
+                              &sequenceDecrease) != 0) {
+            break;
+        }
+        double quantity = model.getColSolution()[feed];
+        double objectiveFrom = model.getObjValue() - (solvedAt - price) * quantity;
+        double to = min(high, solvedAt + increase);
+
+        if (to > price) {
+            // A basis change that leaves the quantity alone is not a breakpoint
+            if (!segments.empty() &&
+                fabs(segments.back().quantity - quantity) <= 1.0e-9 * max(1.0, fabs(quantity))) {
+                segments.back().priceTo = to;
+            } else {
+                segments.push_back(CostSegment{price, to, quantity, objectiveFrom});
+            }
+            price = to;
+            nudge = 1.0e-9 * max(1.0, fabs(to));
+        } else {
+            nudge *= 10.0; // degenerate: zero-length range, step further out
+        }
+        if (to >= high) {
+            break;
+        }
+
+        // Step just past the breakpoint so the simplex moves to the next basis
+        solvedAt = min(high, price + nudge);
+        model.setObjectiveCoefficient(feed, solvedAt);
+        warmSolve(model, CHANGED_COSTS);
+    }
+
+    model.setObjectiveCoefficient(feed, originalCost);
+    warmSolve(model, CHANGED_COSTS);
+    return segments;
+}
+
+// Objective ranging for every feed (dualRanging) and right-hand side ranging
+// for every row (primalRanging on its slack) around the current optimal
+// basis. Rows that are not binding can drop without limit and rise up to
+// their current activity.
+Ranging rangeModel(ClpSimplex &model) {
+    const double INFINITE_RANGE = 1.0e30;
+    int numColumns = model.numberColumns();
+    int numRows = model.numberRows();
+    const double *cost = model.getObjCoefficients();
+    Ranging ranging;
+
+    vector<int> which(numColumns);
+    vector<double> increase(numColumns), decrease(numColumns);
+    vector<int> sequenceIncrease(numColumns), sequenceDecrease(numColumns);
+    for (int i = 0; i < numColumns; ++i) {
+        which[i] = i;
+    }
+    ranging.costLow.assign(numColumns, -HUGE_VAL);
+    ranging.costHigh.assign(numColumns, HUGE_VAL);
+    if (model.dualRanging(numColumns, which.data(), increase.data(), sequenceIncrease.data(),
+                          decrease.data(), sequenceDecrease.data()) == 0) {
+        for (int i = 0; i < numColumns; ++i) {
+            if (decrease[i] < INFINITE_RANGE) {
+                ranging.costLow[i] = cost[i] - decrease[i];
+            }
+            if (increase[i] < INFINITE_RANGE) {
+                ranging.costHigh[i] = cost[i] + increase[i];
+            }
+        }
+    }
+
+    // Binding rows (nonbasic slack) go through primalRanging; slacks are
+    // numbered after the columns. A row's rhs is its active bound, or for a
+    // basic row the finite bound nearest its activity (spec rows are ranged,
+    // ratio rows may be <= rows); a basic row's rhs can move as far as the
+    // activity on that side.
+    const double *rowLower = model.getRowLower();
+    const double *rowUpper = model.getRowUpper();
+    const double *activity = model.getRowActivity();
+    ranging.rhs.resize(numRows);
+    ranging.rhsLow.assign(numRows, -HUGE_VAL);
+    ranging.rhsHigh.assign(numRows, HUGE_VAL);
+    which.clear();
+    for (int row = 0; row < numRows; ++row) {
+        bool lowerFinite = rowLower[row] > -1.0e+20;
+        bool upperFinite = rowUpper[row] < 1.0e+20;
+        ClpSimplex::Status status = model.getRowStatus(row);
+        bool atUpper;
+        if (status == ClpSimplex::atUpperBound && upperFinite) {
+            atUpper = true;
+        } else if ((status == ClpSimplex::atLowerBound || status == ClpSimplex::isFixed) &&
+                   lowerFinite) {
+            atUpper = false;
+        } else if (lowerFinite && upperFinite) {
+            atUpper = rowUpper[row] - activity[row] < activity[row] - rowLower[row];
+        } else {
+            atUpper = upperFinite;
+        }
+        ranging.rhs[row] = atUpper ? rowUpper[row] : rowLower[row];
+        if (status != ClpSimplex::basic) {
+            which.push_back(numColumns + row);
+        } else if (atUpper) {
+            ranging.rhsLow[row] = activity[row];
+        } else {
+            ranging.rhsHigh[row] = activity[row];
+        }
+    }
+    int numBinding = which.size();
+    increase.resize(numBinding);
+    decrease.resize(numBinding);
+    sequenceIncrease.resize(numBinding);
+    sequenceDecrease.resize(numBinding);
+    if (numBinding > 0 &&
+        model.primalRanging(numBinding, which.data(), increase.data(), sequenceIncrease.data(),
+                            decrease.data(), sequenceDecrease.data()) == 0) {
+        for (int k = 0; k < numBinding; ++k) {
+            int row = which[k] - numColumns;
+            if (decrease[k] < INFINITE_RANGE) {
+                ranging.rhsLow[row] = ranging.rhs[row] - decrease[k];
+            }
+            if (increase[k] < INFINITE_RANGE) {
+                ranging.rhsHigh[row] = ranging.rhs[row] + increase[k];
+            }
+        }
+    }
+    return ranging;
+}
+
+
+// --- 13. MULTI-PERIOD MODEL: Products x periods x feeds ---
+
+// Many products blended over many periods from shared feed inventories. The
+// feeds, their content and their purchase prices come from a BlendProblem,
+// which is shared read-only. Per product and period there is a contract
+// demand and the product's own minimum specs; per feed and period there is a
+// purchase availability, and stock carries over between periods.
+//
+// Columns:  x[p,t,i] feed i blended into product p in period t
+//           b[i,t]   feed i bought in period t   (cost: feed price)
+//           s[i,t]   feed i in stock at the end of period t (cost: holding)
+// Rows:     demand[p,t]      sum_i x[p,t,i] = demand
+//           spec[p,t,j]      sum_i C_ij x[p,t,i] >= reqMin[p,j] * demand
+//           balance[i,t]     s[i,t-1] + b[i,t] - sum_p x[p,t,i] - s[i,t] = 0
+//           capacity[t]      sum_p sum_i x[p,t,i] <= plant capacity
+// The (p,t) demand and spec rows with the x[p,t,.] columns form one block,
+// i.e. the single-blend model of buildModel().
+struct MultiPeriodProblem {
+    const BlendProblem *feeds = nullptr;
+    int numProducts = 0;
+    int numPeriods = 0;
+    vector<string> productNames;
+    vector<double> demand;         // [p * numPeriods + t]
+    vector<double> productReqMin;  // [p * numComponents + j], fractions
+    vector<double> purchaseLimit;  // [t * numFeeds + i], upper bound of b[i,t]
+    vector<double> initialStock;   // [i]
+    vector<double> storageLimit;   // [i], upper bound of s[i,t]
+    vector<double> holdingCost;    // [i], $/unit per period
+    vector<double> plantCapacity;  // [t]
+
+    int numFeeds() const { return feeds->numFeeds(); }
+    int numComponents() const { return feeds->numComponents(); }
+
+    // Column and row numbering (see above)
+    long blendColumn(int p, int t, int i) const {
+        return (static_cast<long>(p) * numPeriods + t) * numFeeds() + i;
+    }
+    long purchaseColumn(int i, int t) const {
+        return static_cast<long>(numProducts) * numPeriods * numFeeds() +
+               static_cast<long>(t) * numFeeds() + i;
+    }
+    long stockColumn(int i, int t) const {
+        return purchaseColumn(0, numPeriods) + static_cast<long>(t) * numFeeds() + i;
+    }
+    long numColumns() const { return stockColumn(0, numPeriods); }
+
+    long demandRow(int p, int t) const {
+        return (static_cast<long>(p) * numPeriods + t) * (numComponents() + 1);
+    }
+    long balanceRow(int i, int t) const {
+        return demandRow(numProducts, 0) + static_cast<long>(t) * numFeeds() + i;
+    }
+    long capacityRow(int t) const { return balanceRow(0, numPeriods) + t; }
+    long numRows() const { return capacityRow(numPeriods); }
+};
+
+// A demo multi-period problem around `base`: products with somewhat relaxed
+// copies of the base specs, demand around the base blend size, plenty of
+// feed availability and storage, and a 1% per period holding cost.
+MultiPeriodProblem expandProblem(const BlendProblem &base, int numProducts, int numPeriods) {
+    MultiPeriodProblem multi;
+    multi.feeds = &base;
+    multi.numProducts = numProducts;
+    multi.numPeriods = numPeriods;
+    int numFeeds = base.numFeeds();
+    int numComponents = base.numComponents();
+
+    for (int p = 0; p < numProducts; ++p) {
+        multi.productNames.push_back("P" + to_string(p + 1));
+        for (int t = 0; t < numPeriods; ++t) {
+            multi.demand.push_back(base.totalBlend * (1.0 + 0.1 * ((p + t) % 3)));
+        }
+        for (int j = 0; j < numComponents; ++j) {
+            multi.productReqMin.push_back(base.reqMin[j] * (1.0 - 0.02 * (p % 5)));
+        }
+    }
+    double totalDemand = 0.0;
+    for (double d : multi.demand) {
+        totalDemand += d;
+    }
+    multi.purchaseLimit.assign(static_cast<size_t>(numPeriods) * numFeeds, 1.0e+20);
+    multi.initialStock.assign(numFeeds, 0.0);
+    multi.storageLimit.assign(numFeeds, totalDemand);
+    for (int i = 0; i < numFeeds; ++i) {
+        multi.holdingCost.push_back(0.01 * base.cost[i]);
+    }
+    multi.plantCapacity.assign(numPeriods, 1.0e+20);
+    return multi;
+}
+
+// Loads a multi-period problem into an empty model. The nonzero count of
+// every column is known in closed form (3 + the feed's content for x, 1 for
+// b, 2 for s except in the last period), so every block's slice of the CSC
+// arrays is known before anything is written. The product x period blocks
+// and the per-period inventory blocks are then filled concurrently, each on
+// its own slice, in O(nnz) total work and with one allocation per array.
+bool buildMultiPeriodModel(ClpSimplex &model, const MultiPeriodProblem &multi, BuildArena &arena,
+                           int numThreads, string &error) {
+    BLENDER_TIME_PHASE(PHASE_BUILD);
+    arena.reset();
+
+    const BlendProblem &feeds = *multi.feeds;
+    const int F = multi.numFeeds();
+    const int C = multi.numComponents();
+    const int P = multi.numProducts;
+    const int T = multi.numPeriods;
+
+    // Content kept per feed and where each feed's x column starts in a block
+    vector<long> contentBefore(F + 1, 0);
+    for (int i = 0; i < F; ++i) {
+        long kept = 0;
+        for (int k = feeds.contentStart[i]; k < feeds.contentStart[i + 1]; ++k) {
+            kept += fabs(feeds.fraction(k)) > feeds.dropTolerance;
+        }
+        contentBefore[i + 1] = contentBefore[i] + kept;
+    }
+    const long blockElements = 3L * F + contentBefore[F];
+    const long blendElements = static_cast<long>(P) * T * blockElements;
+    const long numElements = blendElements + static_cast<long>(T) * F + (2L * T - 1) * F;
+    const long numColumns = multi.numColumns();
+    const long numRows = multi.numRows();
+    if (numElements > numeric_limits<CoinBigIndex>::max() || numColumns > INT_MAX ||
+        numRows > INT_MAX) {
+        error = "model too large for this CLP build";
+        return false;
+    }
+
+    auto blendStart = [&](int p, int t, int i) {
+        return (static_cast<long>(p) * T + t) * blockElements + 3L * i + contentBefore[i];
+    };
+    auto purchaseStart = [&](int i, int t) {
+        return blendElements + static_cast<long>(t) * F + i;
+    };
+    auto stockStart = [&](int i, int t) {
+        return blendElements + static_cast<long>(T) * F + 2L * F * t + (t + 1 < T ? 2L * i : i);
+    };
+
+    double *columnLower = arena.allocate<double>(numColumns);
+    double *columnUpper = arena.allocate<double>(numColumns);
+    double *objective = arena.allocate<double>(numColumns);
+    double *rowLower = arena.allocate<double>(numRows);
+    double *rowUpper = arena.allocate<double>(numRows);
+    CoinBigIndex *columnStarts = arena.allocate<CoinBigIndex>(numColumns + 1);
+    int *rowIndices = arena.allocate<int>(numElements);
+    double *elements = arena.allocate<double>(numElements);
+
+    // Block (p, t): x[p,t,.] columns, demand[p,t] and spec[p,t,.] rows
+    auto fillBlendBlock = [&](int p, int t) {
+        long demandRow = multi.demandRow(p, t);
+        double demand = multi.demand[static_cast<long>(p) * T + t];
+        rowLower[demandRow] = demand;
+        rowUpper[demandRow] = demand;
+        for (int j = 0; j < C; ++j) {
+            rowLower[demandRow + 1 + j] = multi.productReqMin[static_cast<long>(p) * C + j] * demand;
+            rowUpper[demandRow + 1 + j] = 1.0e+20;
+        }
+
+        for (int i = 0; i < F; ++i) {
+            long column = multi.blendColumn(p, t, i);
+            long next = blendStart(p, t, i);
+            columnStarts[column] = next;
+            columnLower[column] = 0.0;
+            columnUpper[column] = 1.0e+20;
+            objective[column] = 0.0;
+
+            rowIndices[next] = demandRow;
+            elements[next++] = 1.0;
+            for (int k = feeds.contentStart[i]; k < feeds.contentStart[i + 1]; ++k) {
+                double fraction = feeds.fraction(k);
+                if (fabs(fraction) > feeds.dropTolerance) {
+                    rowIndices[next] = demandRow + 1 + feeds.contentComponent[k];
+                    elements[next++] = fraction;
+                }
+            }
+            rowIndices[next] = multi.balanceRow(i, t);
+            elements[next++] = -1.0;
+            rowIndices[next] = multi.capacityRow(t);
+            elements[next++] = 1.0;
+        }
+    };
+
+    // Inventory block t: b[.,t] and s[.,t] columns, balance[.,t] and capacity[t] rows
+    auto fillInventoryBlock = [&](int t) {
+        for (int i = 0; i < F; ++i) {
+            long balanceRow = multi.balanceRow(i, t);
+            double opening = t == 0 ? multi.initialStock[i] : 0.0;
+            rowLower[balanceRow] = -opening;
+            rowUpper[balanceRow] = -opening;
+
+            long column = multi.purchaseColumn(i, t);
+            long next = purchaseStart(i, t);
+            columnStarts[column] = next;
+            columnLower[column] = 0.0;
+            columnUpper[column] = multi.purchaseLimit[static_cast<long>(t) * F + i];
+            objective[column] = feeds.cost[i];
+            rowIndices[next] = balanceRow;
+            elements[next] = 1.0;
+
+            column = multi.stockColumn(i, t);
+            next = stockStart(i, t);
+            columnStarts[column] = next;
+            columnLower[column] = 0.0;
+            columnUpper[column] = multi.storageLimit[i];
+            objective[column] = multi.holdingCost[i];
+            rowIndices[next] = balanceRow;
+            elements[next++] = -1.0;
+            if (t + 1 < T) {
+                rowIndices[next] = multi.balanceRow(i, t + 1);
+                elements[next] = 1.0;
+            }
+        }
+        long capacityRow = multi.capacityRow(t);
+        rowLower[capacityRow] = -1.0e+20;
+        rowUpper[capacityRow] = multi.plantCapacity[t];
+    };
+
+    int numBlendBlocks = P * T;
+    parallelFor(numBlendBlocks + T, numThreads, [&](int block) {
+        if (block < numBlendBlocks) {
+            fillBlendBlock(block / T, block % T);
+        } else {
+            fillInventoryBlock(block - numBlendBlocks);
+        }
+    });
+    columnStarts[numColumns] = numElements;
+
+    model.loadProblem(numColumns, numRows, columnStarts, rowIndices, elements, columnLower,
+                      columnUpper, objective, rowLower, rowUpper);
+    model.setObjSense(1.0);
+    model.scaling(solveOptions.scaling);
+
+    CountingEventHandler counter;
+    model.passInEventHandler(&counter);
+    return true;
+}
+
+// Builds and solves the demo multi-period expansion of `base`.
+int runMultiPeriod(const BlendProblem &base, int numProducts, int numPeriods, int numThreads) {
+    MultiPeriodProblem multi = expandProblem(base, numProducts, numPeriods);
+    BuildArena arena;
+    ClpSimplex model;
+    string error;
+
+    auto startTime = chrono::steady_clock::now();
+    if (!buildMultiPeriodModel(model, multi, arena, numThreads, error)) {
+        cerr << "Cannot build the multi-period model: " << error << endl;
+        return 1;
+    }
+    double buildSeconds = chrono::duration<double>(chrono::steady_clock::now() - startTime).count();
+    model.setLogLevel(0);
+
+    startTime = chrono::steady_clock::now();
+    solveWithBasisStore(model);
+    double solveSeconds = chrono::duration<double>(chrono::steady_clock::now() - startTime).count();
+
+    cout << "Multi-period model: " << numProducts << " products x " << numPeriods << " periods x "
+         << multi.numFeeds() << " feeds: " << model.numberColumns() << " columns, "
+         << model.numberRows() << " rows, " << model.matrix()->getNumElements() << " nonzeros"
+         << endl;
+    cout << "Built in " << buildSeconds << " s on " << numThreads << " threads, solved in "
+         << solveSeconds << " s (" << model.numberIterations() << " iterations, "
+         << ALGORITHM_NAMES[solverStats.lastAlgorithm.load()] << ")" << endl;
+    if (model.isProvenOptimal()) {
+        cout << "Status: Optimal\nMinimum Total Cost: $" << model.getObjValue() << endl;
+    } else {
+        cout << "Status: Not Optimal (" << model.status() << ")" << endl;
+    }
+    return 0;
+}
+
+
+// --- 14. DECOMPOSITION: Dantzig-Wolfe over the product x period blocks ---
+
+// Only the balance and capacity rows tie the (p,t) blocks together, and each
+// block is the single-blend model of buildModel(). The restricted master
+// keeps the purchase and stock columns with the linking rows, plus one
+// convexity row per block; each block contributes blends (extreme points of
+// its own demand and spec rows) as master columns. Pricing a block is a
+// single-blend solve with feed i priced at
+//     y_balance[i,t] - y_capacity[t]
+// (its reduced cost with respect to the linking rows), run for all blocks in
+// parallel on models built once and re-solved warm.
+//
+// The master's objective is an upper bound; adding each block's most
+// negative reduced cost gives the Lagrangian lower bound, and the run stops
+// once the two meet within the gap tolerance.
+const int DECOMPOSITION_MAX_ITERATIONS = 1000;
+const double DECOMPOSITION_GAP = 1.0e-6;
+
+struct DecompositionStep {
+    double upperBound;
+    double lowerBound;
+    double gap;        // relative to max(1, |upperBound|)
+    int proposals;     // columns added this iteration
+    double seconds;    // since the start of the run
+};
+
+struct DecompositionReport {
+    bool converged = false;
+    int iterations = 0;
+    int proposals = 0;
+    double objective = 0.0;
+    double lowerBound = -1.0e+20;
+    double gap = 1.0e+20;
+    double artificialUse = 0.0;  // > 0: the linking rows cannot be met
+    double seconds = 0.0;
+    double pricingSeconds = 0.0;
+    double masterSeconds = 0.0;
+    vector<DecompositionStep> history;
+};
+
+class DantzigWolfe {
+public:
+    DantzigWolfe(const MultiPeriodProblem &multi, int numThreads)
+            : multi_(multi), numThreads_(numThreads) {
+        const BlendProblem &feeds = *multi_.feeds;
+        int numBlocks = multi_.numProducts * multi_.numPeriods;
+        prices_.resize(static_cast<size_t>(numBlocks) * feeds.numFeeds());
+        blockCost_.resize(numBlocks);
+        for (int k = 0; k < numBlocks; ++k) {
+            blocks_.push_back(unique_ptr<ClpSimplex>(new ClpSimplex));
+        }
+
+        // The penalty on the artificial columns has to exceed any price a
+        // feasible master can put on a linking row
+        double maxCost = 0.0;
+        for (int i = 0; i < feeds.numFeeds(); ++i) {
+            maxCost = max(maxCost, fabs(feeds.cost[i]) + fabs(multi_.holdingCost[i]) * multi_.numPeriods);
+        }
+        penalty_ = 1.0e+3 * (maxCost + 1.0);
+    }
+
+    const ClpSimplex &master() const { return master_; }
+
+    bool solve(int maxIterations, double gapTolerance, DecompositionReport &report, string &error) {
+        auto startTime = chrono::steady_clock::now();
+        auto elapsed = [&]() {
+            return chrono::duration<double>(chrono::steady_clock::now() - startTime).count();
+        };
+        report = DecompositionReport();
+
+        // Build every block once, priced at the plain feed costs; those
+        // blends make a first master column per block
+        const int F = multi_.numFeeds();
+        for (int t = 0; t < multi_.numPeriods; ++t) {
+            for (int i = 0; i < F; ++i) {
+                for (int p = 0; p < multi_.numProducts; ++p) {
+                    prices_[static_cast<size_t>(block(p, t)) * F + i] = multi_.feeds->cost[i];
+                }
+            }
+        }
+        double phaseStart = elapsed();
+        parallelFor(numBlocks(), numThreads_, [&](int k) { buildBlock(k); });
+        if (!priced(error)) {
+            return false;
+        }
+        report.pricingSeconds += elapsed() - phaseStart;
+
+        phaseStart = elapsed();
+        buildMaster();
+        report.proposals = addProposals(nullptr);
+        warmSolve(master_, CHANGED_STRUCTURE);
+        report.masterSeconds += elapsed() - phaseStart;
+
+        while (report.iterations < maxIterations) {
+            if (!master_.isProvenOptimal()) {
+                error = "restricted master not optimal (status " + to_string(master_.status()) + ")";
+                return false;
+            }
+            ++report.iterations;
+            const double *duals = master_.dualRowSolution();
+
+            phaseStart = elapsed();
+            parallelFor(numBlocks(), numThreads_, [&](int k) { priceBlock(k, duals); });
+            if (!priced(error)) {
+                return false;
+            }
+            report.pricingSeconds += elapsed() - phaseStart;
+
+            // Lagrangian bound: master value plus every block's best reduced cost
+            report.objective = master_.objectiveValue();
+            double lowerBound = report.objective;
+            for (int k = 0; k < numBlocks(); ++k) {
+                lowerBound += min(0.0, blockCost_[k] - duals[convexityRow(k)]);
+            }
+            report.lowerBound = max(report.lowerBound, lowerBound);
+            report.gap = (report.objective - report.lowerBound) / max(1.0, fabs(report.objective));
+
+            phaseStart = elapsed();
+            int added = 0;
+            if (report.gap > gapTolerance) {
+                added = addProposals(duals);
+            }
+            report.history.push_back({report.objective, report.lowerBound, report.gap, added, elapsed()});
+            if (added == 0) {
+                report.converged = true;
+                break;
+            }
+            report.proposals += added;
+            warmSolve(master_, CHANGED_STRUCTURE);
+            report.masterSeconds += elapsed() - phaseStart;
+        }
+
+        report.objective = master_.objectiveValue();
+        const double *solution = master_.primalColumnSolution();
+        for (int column = artificialColumn(0); column < firstProposal(); ++column) {
+            report.artificialUse += solution[column];
+        }
+        report.seconds = elapsed();
+        return true;
+    }
+
+private:
+    int numBlocks() const { return multi_.numProducts * multi_.numPeriods; }
+    int block(int p, int t) const { return p * multi_.numPeriods + t; }
+    int periodOf(int k) const { return k % multi_.numPeriods; }
+
+    // Master rows: balance[i,t], capacity[t], convexity[p,t]
+    int balanceRow(int i, int t) const { return t * multi_.numFeeds() + i; }
+    int capacityRow(int t) const { return multi_.numPeriods * multi_.numFeeds() + t; }
+    int convexityRow(int k) const { return capacityRow(multi_.numPeriods) + k; }
+
+    // Master columns: b[i,t], s[i,t], artificial supply per balance row,
+    // artificial capacity per period, then the proposed blends
+    int purchaseColumn(int i, int t) const { return t * multi_.numFeeds() + i; }
+    int stockColumn(int i, int t) const { return purchaseColumn(0, multi_.numPeriods) + purchaseColumn(i, t); }
+    int artificialColumn(int row) const { return stockColumn(0, multi_.numPeriods) + row; }
+    int firstProposal() const { return artificialColumn(capacityRow(multi_.numPeriods)); }
+
+    // Block k as a single-blend model: its demand as the total, its product's
+    // specs as the minimums and the current prices as the costs
+    void buildBlock(int k) {
+        const BlendProblem &feeds = *multi_.feeds;
+        int p = k / multi_.numPeriods;
+        ProblemView view = feeds.view();
+        view.reqMax = nullptr; // the multi-period model has min specs only
+        view.available = nullptr;
+        view.numRatios = 0;
+        view.cost = &prices_[static_cast<size_t>(k) * feeds.numFeeds()];
+        view.reqMin = &multi_.productReqMin[static_cast<size_t>(p) * feeds.numComponents()];
+        view.totalBlend = multi_.demand[k];
+
+        BuildArena arena;
+        ClpSimplex &model = *blocks_[k];
+        buildModel(model, view, arena);
+        model.setLogLevel(0);
+        coldSolve(model);
+        finishBlock(k);
+    }
+
+    void priceBlock(int k, const double *duals) {
+        const int F = multi_.numFeeds();
+        int t = periodOf(k);
+        ClpSimplex &model = *blocks_[k];
+        for (int i = 0; i < F; ++i) {
+            double price = duals[balanceRow(i, t)] - duals[capacityRow(t)];
+            prices_[static_cast<size_t>(k) * F + i] = price;
+            model.setObjectiveCoefficient(i, price);
+        }
+        warmSolve(model, CHANGED_COSTS);
+        finishBlock(k);
+    }
+
+    // Records the block's priced cost (z_k); NaN marks a failed solve
+    void finishBlock(int k) {
+        ClpSimplex &model = *blocks_[k];
+        if (!model.isProvenOptimal()) {
+            blockCost_[k] = NAN;
+            return;
+        }
+        const int F = multi_.numFeeds();
+        const double *x = model.primalColumnSolution();
+        double cost = 0.0;
+        for (int i = 0; i < F; ++i) {
+            cost += prices_[static_cast<size_t>(k) * F + i] * x[i];
+        }
+        blockCost_[k] = cost;
+    }
+
+    bool priced(string &error) const {
+        for (int k = 0; k < numBlocks(); ++k) {
+            if (std::isnan(blockCost_[k])) {
+                error = "block " + multi_.productNames[k / multi_.numPeriods] + " period " +
+                        to_string(periodOf(k) + 1) + " has no feasible blend";
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void buildMaster() {
+        const BlendProblem &feeds = *multi_.feeds;
+        const int F = multi_.numFeeds();
+        const int T = multi_.numPeriods;
+        int numRows = convexityRow(numBlocks());
+        int numColumns = firstProposal();
+
+        vector<double> rowLower(numRows), rowUpper(numRows);
+        for (int t = 0; t < T; ++t) {
+            for (int i = 0; i < F; ++i) {
+                double opening = t == 0 ? multi_.initialStock[i] : 0.0;
+                rowLower[balanceRow(i, t)] = -opening;
+                rowUpper[balanceRow(i, t)] = -opening;
+            }
+            rowLower[capacityRow(t)] = -1.0e+20;
+            rowUpper[capacityRow(t)] = multi_.plantCapacity[t];
+        }
+        for (int k = 0; k < numBlocks(); ++k) {
+            rowLower[convexityRow(k)] = 1.0;
+            rowUpper[convexityRow(k)] = 1.0;
+        }
+
+        vector<double> columnLower(numColumns, 0.0), columnUpper(numColumns), objective(numColumns);
+        vector<CoinBigIndex> columnStarts;
+        vector<int> rowIndices;
+        vector<double> elements;
+        auto addEntry = [&](int row, double value) {
+            rowIndices.push_back(row);
+            elements.push_back(value);
+        };
+        for (int t = 0; t < T; ++t) {
+            for (int i = 0; i < F; ++i) {
+                int column = purchaseColumn(i, t);
+                columnStarts.push_back(rowIndices.size());
+                columnUpper[column] = multi_.purchaseLimit[static_cast<size_t>(t) * F + i];
+                objective[column] = feeds.cost[i];
+                addEntry(balanceRow(i, t), 1.0);
+            }
+        }
+        for (int t = 0; t < T; ++t) {
+            for (int i = 0; i < F; ++i) {
+                int column = stockColumn(i, t);
+                columnStarts.push_back(rowIndices.size());
+                columnUpper[column] = multi_.storageLimit[i];
+                objective[column] = multi_.holdingCost[i];
+                addEntry(balanceRow(i, t), -1.0);
+                if (t + 1 < T) {
+                    addEntry(balanceRow(i, t + 1), 1.0);
+                }
+            }
+        }
+        for (int row = 0; row < capacityRow(T); ++row) {
+            int column = artificialColumn(row);
+            columnStarts.push_back(rowIndices.size());
+            columnUpper[column] = 1.0e+20;
+            objective[column] = penalty_;
+            addEntry(row, row < capacityRow(0) ? 1.0 : -1.0);
+        }
+        columnStarts.push_back(rowIndices.size());
+
+        master_.loadProblem(numColumns, numRows, columnStarts.data(), rowIndices.data(),
+                            elements.data(), columnLower.data(), columnUpper.data(),
+                            objective.data(), rowLower.data(), rowUpper.data());
+        master_.setObjSense(1.0);
+        master_.scaling(solveOptions.scaling);
+        master_.setLogLevel(0);
+    }
+
+    // Adds the current blend of every block whose reduced cost is negative
+    // (of every block when `duals` is null). Returns the number added.
+    int addProposals(const double *duals) {
+        const int F = multi_.numFeeds();
+        starts_.clear();
+        rows_.clear();
+        elements_.clear();
+        starts_.push_back(0);
+        for (int k = 0; k < numBlocks(); ++k) {
+            if (duals && blockCost_[k] - duals[convexityRow(k)] > -REDUCED_COST_TOLERANCE) {
+                continue;
+            }
+            int t = periodOf(k);
+            const double *x = blocks_[k]->primalColumnSolution();
+            double blended = 0.0;
+            for (int i = 0; i < F; ++i) {
+                if (x[i] > 1.0e-12) {
+                    rows_.push_back(balanceRow(i, t));
+                    elements_.push_back(-x[i]);
+                    blended += x[i];
+                }
+            }
+            rows_.push_back(capacityRow(t));
+            elements_.push_back(blended);
+            rows_.push_back(convexityRow(k));
+            elements_.push_back(1.0);
+            starts_.push_back(rows_.size());
+        }
+
+        int added = starts_.size() - 1;
+        if (added > 0) {
+            lower_.assign(added, 0.0);
+            upper_.assign(added, 1.0e+20);
+            objective_.assign(added, 0.0);  // the blend itself costs only its purchases
+            master_.addColumns(added, lower_.data(), upper_.data(), objective_.data(),
+                               starts_.data(), rows_.data(), elements_.data());
+        }
+        return added;
+    }
+
+    static constexpr double REDUCED_COST_TOLERANCE = 1.0e-9;
+
+    const MultiPeriodProblem &multi_;
+    int numThreads_;
+    double penalty_ = 0.0;
+    ClpSimplex master_;
+    vector<unique_ptr<ClpSimplex>> blocks_;
+    vector<double> prices_;        // [k * numFeeds + i], block k's current feed prices
+    vector<double> blockCost_;     // z_k at the current prices
+    // Scratch for addProposals
+    vector<CoinBigIndex> starts_;
+    vector<int> rows_;
+    vector<double> elements_, lower_, upper_, objective_;
+};
+
+// Solves the demo multi-period problem by decomposition and then as one
+// monolithic model, and compares the two.
+int runDecomposition(const BlendProblem &base, int numProducts, int numPeriods, int numThreads) {
+    MultiPeriodProblem multi = expandProblem(base, numProducts, numPeriods);
+
+    DantzigWolfe decomposition(multi, numThreads);
+    DecompositionReport report;
+    string error;
+    if (!decomposition.solve(DECOMPOSITION_MAX_ITERATIONS, DECOMPOSITION_GAP, report, error)) {
+        cerr << "Decomposition failed: " << error << endl;
+        return 1;
+    }
+
+    cout << "Iteration\tUpper bound\tLower bound\tGap\tColumns\tSeconds" << endl;
+    for (size_t n = 0; n < report.history.size(); ++n) {
+        const DecompositionStep &step = report.history[n];
+        cout << n + 1 << "\t" << step.upperBound << "\t" << step.lowerBound << "\t" << step.gap
+             << "\t" << step.proposals << "\t" << step.seconds << "\n";
+    }
+
+    BuildArena arena;
+    ClpSimplex monolithic;
+    auto startTime = chrono::steady_clock::now();
+    if (!buildMultiPeriodModel(monolithic, multi, arena, numThreads, error)) {
+        cerr << "Cannot build the multi-period model: " << error << endl;
+        return 1;
+    }
+    monolithic.setLogLevel(0);
+    coldSolve(monolithic);
+    double monolithicSeconds = chrono::duration<double>(chrono::steady_clock::now() - startTime).count();
+
+    cout << "Decomposition: " << (report.converged ? "converged" : "iteration limit") << " after "
+         << report.iterations << " iterations, " << report.proposals << " columns, gap "
+         << report.gap << endl;
+    cout << "  objective " << report.objective << ", lower bound " << report.lowerBound << endl;
+    cout << "  " << report.seconds << " s (pricing " << report.pricingSeconds << " s, master "
+         << report.masterSeconds << " s) on " << numThreads << " threads" << endl;
+    if (report.artificialUse > 1.0e-7) {
+        cout << "  linking rows infeasible: artificial use " << report.artificialUse << endl;
+    }
+    if (monolithic.isProvenOptimal()) {
+        cout << "Monolithic: objective " << monolithic.getObjValue() << " in " << monolithicSeconds
+             << " s (difference " << report.objective - monolithic.getObjValue() << ")" << endl;
+    } else {
+        cout << "Monolithic: Not Optimal (" << monolithic.status() << ") in " << monolithicSeconds
+             << " s" << endl;
+    }
+    return 0;
+}
+
+#endif
+
+
+// --- 15. EMBEDDED: Solve the compiled example image ---
+
+// The startup path for the controller build: no problem parsing, no
+// BlendProblem, no presolve, just the prebuilt image from section 1a.
+// Build with -DBLENDER_EMBEDDED=1 to make this the whole program, or run
+// --embedded to try it on a desktop build. It prints through stdio, which
+// the embedded build has without iostreams.
+
+int runEmbedded() {
+    ClpSimplex model;
+    loadImage(model, EXAMPLE_IMAGE);
+    model.setLogLevel(0);
+
+    ClpSolve options;
+    options.setPresolveType(ClpSolve::presolveOff);
+    {
+        BLENDER_TIME_PHASE(PHASE_SIMPLEX);
+        model.initialSolve(options);
+    }
+    recordSolve(model);
+
+    if (model.isProvenOptimal()) {
+        printf("Status: Optimal\n");
+        printf("Minimum Total Cost: $%g\n", model.getObjValue());
+
+        const double *solution = model.getColSolution();
+
+        printf("\nOptimal Feed Quantities:\n");
+        for (int i = 0; i < EXAMPLE_IMAGE.NUM_COLUMNS; ++i) {
+            printf("  Feed %s: %g units\n", EXAMPLE_RECIPE.feeds[i], solution[i]);
+        }
+    } else {
+        printf("Status: Not Optimal (%d)\n", model.status());
+    }
+    fflush(stdout);
+    return 0;
+}
+
+
+#if !BLENDER_EMBEDDED  // sections 16 to 18
+
+// --- 16. SERVER: Micro-batched solve service over TCP ---
+
+// A long-running replacement for one process per request. Clients send
+// scenario lines (the --batch format) over TCP and get one NDJSON summary
+// line back per request, numbered per connection in the order they were
+// sent; answers can come back out of order.
+//
+// One event loop thread owns every socket. Requests arriving within
+// windowMicros of the first one of a batch (or until maxBatch are waiting)
+// form a micro-batch, which is split into one slice per worker and queued
+// under a single lock. Each worker owns a ScenarioSolver (and with
+// --small-kernel the lane kernel), so warm starts stay on the worker's own
+// ClpSimplex. Workers hand results back through a completion queue that
+// wakes the event loop through an eventfd; the loop formats the responses
+// and writes them without blocking. Request latency (receipt to response
+// queued) is exported as a histogram in the stats file.
+struct ServerOptions {
+    int port = 7070;
+    int windowMicros = 200;  // how long the first request of a batch waits for company
+    int maxBatch = 64;       // dispatch at once when this many are waiting
 };
 
-// Content of component j in feed i (Fraction)
-const map<string, map<string, double>> CONTENT = {
-    {"A", {{"X", 0.60}, {"Y", 0.10}}},
-    {"B", {{"X", 0.30}, {"Y", 0.50}}},
-    {"C", {{"X", 0.20}, {"Y", 0.30}}}
+#ifdef __linux__
+
+struct ServerRequest {
+    uint64_t connection;
+    long number;
+    Scenario scenario;
+    chrono::steady_clock::time_point received;
 };
 
-// Minimum required content in the final blend (Fraction)
-const map<string, double> REQ_MIN = {
-    {"X", 0.40},
-    {"Y", 0.30}
+struct Completion {
+    uint64_t connection;
+    long number;
+    ScenarioResult result;
+    chrono::steady_clock::time_point received;
 };
 
+// Slices of micro-batches waiting for a worker
+class SliceQueue {
+public:
+    void push(vector<vector<ServerRequest>> &slices) {
+        {
+            lock_guard<mutex> lock(mutex_);
+            for (vector<ServerRequest> &slice : slices) {
+                slices_.push_back(move(slice));
+            }
+        }
+        ready_.notify_all();
+    }
 
-int main() {
-    // 2. INITIALIZE THE SOLVER
-    ClpSimplex model;
+    // Blocks until there is a slice; false once the queue is closed and empty
+    bool pop(vector<ServerRequest> &slice) {
+        unique_lock<mutex> lock(mutex_);
+        ready_.wait(lock, [&]() { return closed_ || !slices_.empty(); });
+        if (slices_.empty()) {
+            return false;
+        }
+        slice = move(slices_.front());
+        slices_.pop_front();
+        return true;
+    }
 
-    // --- 3. VARIABLES: Set up columns (variables) ---
-    int numVars = FEEDS.size(); // 3 variables: x_A, x_B, x_C
-    
-    // Set variable bounds (lower bound = 0, upper bound = infinity)
-    // All variables are non-negative (x >= 0)
-    double *columnLower = new double[numVars];
-    double *columnUpper = new double[numVars];
-    double *objective = new double[numVars];
+    void close() {
+        {
+            lock_guard<mutex> lock(mutex_);
+            closed_ = true;
+        }
+        ready_.notify_all();
+    }
 
-    for (int i = 0; i < numVars; ++i) {
-        string feed = FEEDS[i];
-        columnLower[i] = 0.0;
-        columnUpper[i] = 1.0e+20; // Represents infinity
-        // Set the objective coefficients (the costs)
-        objective[i] = COSTS.at(feed);
+private:
+    mutex mutex_;
+    condition_variable ready_;
+    deque<vector<ServerRequest>> slices_;
+    bool closed_ = false;
+};
+
+// Finished requests on their way back to the event loop
+class CompletionQueue {
+public:
+    CompletionQueue() : eventFd_(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) {}
+    CompletionQueue(const CompletionQueue &) = delete;
+    CompletionQueue &operator=(const CompletionQueue &) = delete;
+    ~CompletionQueue() { close(eventFd_); }
+
+    int eventFd() const { return eventFd_; }
+
+    void push(vector<Completion> &done) {
+        {
+            lock_guard<mutex> lock(mutex_);
+            items_.insert(items_.end(), done.begin(), done.end());
+        }
+        uint64_t one = 1;
+        ssize_t put = write(eventFd_, &one, sizeof(one));
+        (void)put;  // EAGAIN: the counter is already non-zero, the loop will wake
     }
 
-    // Add variables to the model
-    model.addColumns(numVars, columnLower, columnUpper, objective);
-    
-    // Clean up temporary arrays
-    delete[] columnLower;
-    delete[] columnUpper;
-    delete[] objective;
+    // Takes everything queued so far; `done` must be empty
+    void drain(vector<Completion> &done) {
+        uint64_t count;
+        ssize_t got = read(eventFd_, &count, sizeof(count));
+        (void)got;
+        lock_guard<mutex> lock(mutex_);
+        swap(done, items_);
+    }
 
+private:
+    int eventFd_;
+    mutex mutex_;
+    vector<Completion> items_;
+};
 
-    // --- 4. CONSTRAINTS: Set up rows ---
-    
-    // Row bounds (lower and upper limits for the constraints)
-    // Row 0: Total Flow (Equality: lower = upper = 100.0)
-    // Row 1: Component X (Greater than or equal: lower = 40.0, upper = infinity)
-    // Row 2: Component Y (Greater than or equal: lower = 30.0, upper = infinity)
-    double *rowLower = new double[3];
-    double *rowUpper = new double[3];
+volatile sig_atomic_t stopServer = 0;
 
-    // Constraint 0: Total Flow (Sum(x_i) = 100.0)
-    rowLower[0] = TOTAL_BLEND;
-    rowUpper[0] = TOTAL_BLEND;
+extern "C" void onStopSignal(int) {
+    stopServer = 1;
+}
+
+void recordLatency(chrono::steady_clock::duration latency) {
+    double seconds = chrono::duration<double>(latency).count();
+    int bucket = 0;
+    while (bucket < NUM_LATENCY_BUCKETS - 1 && seconds > LATENCY_BUCKET_SECONDS[bucket]) {
+        ++bucket;
+    }
+    solverStats.serverLatencyBuckets[bucket].fetch_add(1, memory_order_relaxed);
+    solverStats.serverLatencyNanos.fetch_add(chrono::duration_cast<chrono::nanoseconds>(latency).count(),
+                                             memory_order_relaxed);
+    solverStats.serverRequests.fetch_add(1, memory_order_relaxed);
+}
 
-    // Constraint 1: Component X (Sum(x_i * C_iX) >= 0.40 * 100.0 = 40.0)
-    rowLower[1] = REQ_MIN.at("X") * TOTAL_BLEND;
-    rowUpper[1] = 1.0e+20; 
+int runServer(const BlendProblem &problem, const ServerOptions &options, int numWorkers,
+              const char *statsFile) {
+    // epoll tags for the fixed descriptors; connections count up from FIRST_CONNECTION
+    const uint64_t LISTENER = 0, COMPLETIONS = 1, BATCH_TIMER = 2, FIRST_CONNECTION = 3;
+    const size_t READ_BYTES = 64 * 1024;
+    // A client that sends a longer line, or lets more answers pile up
+    // unread, is disconnected
+    const size_t MAX_REQUEST_BYTES = 64 * 1024;
+    const size_t MAX_PENDING_OUTPUT = 16 << 20;
 
-    // Constraint 2: Component Y (Sum(x_i * C_iY) >= 0.30 * 100.0 = 30.0)
-    rowLower[2] = REQ_MIN.at("Y") * TOTAL_BLEND;
-    rowUpper[2] = 1.0e+20; 
-    
-    // 5. Build the Constraint Matrix (A)
-    // This defines the coefficients for each variable in each constraint.
-    vector<int> rowIndices;
-    vector<int> columnIndices;
+    int listener = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    int reuse = 1;
+    setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+    sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+    address.sin_port = htons(options.port);
+    if (listener < 0 || bind(listener, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0 ||
+        listen(listener, SOMAXCONN) != 0) {
+        cerr << "Cannot listen on port " << options.port << ": " << strerror(errno) << endl;
+        if (listener >= 0) {
+            close(listener);
+        }
+        return 1;
+    }
+
+    CompletionQueue completions;
+    SliceQueue slices;
+    int timer = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    int poller = epoll_create1(EPOLL_CLOEXEC);
+    auto watch = [&](int fd, uint64_t tag, uint32_t events, int op) {
+        epoll_event event;
+        memset(&event, 0, sizeof(event));
+        event.events = events;
+        event.data.u64 = tag;
+        epoll_ctl(poller, op, fd, &event);
+    };
+    watch(listener, LISTENER, EPOLLIN, EPOLL_CTL_ADD);
+    watch(completions.eventFd(), COMPLETIONS, EPOLLIN, EPOLL_CTL_ADD);
+    watch(timer, BATCH_TIMER, EPOLLIN, EPOLL_CTL_ADD);
+
+    unique_ptr<SmallBlendSolver> kernel;
+    if (solveOptions.smallKernel) {
+        kernel = makeSmallBlendSolver(problem);
+    }
+    vector<thread> workers;
+    for (int w = 0; w < numWorkers; ++w) {
+        workers.emplace_back([&]() {
+            ScenarioSolver solver(problem, false);
+            vector<ServerRequest> slice;
+            vector<Scenario> scenarios;
+            vector<ScenarioResult> results;
+            vector<Completion> done;
+            while (slices.pop(slice)) {
+                scenarios.clear();
+                for (ServerRequest &request : slice) {
+                    scenarios.push_back(move(request.scenario));
+                }
+                results.resize(slice.size());
+                solveScenarios(solver, kernel.get(), scenarios.data(), slice.size(), results.data());
+                done.clear();
+                for (size_t k = 0; k < slice.size(); ++k) {
+                    done.push_back({slice[k].connection, slice[k].number, results[k], slice[k].received});
+                }
+                completions.push(done);
+            }
+        });
+    }
+
+    struct Connection {
+        int fd;
+        string input;
+        string output;
+        long nextRequest = 1;
+        long inFlight = 0;
+        bool peerClosed = false;  // close once the in-flight answers are written
+        bool writing = false;     // EPOLLOUT armed
+    };
+    unordered_map<uint64_t, Connection> connections;
+    uint64_t nextConnection = FIRST_CONNECTION;
+    ResultWriter formatter(OUTPUT_NDJSON, -1);
+
+    auto closeConnection = [&](uint64_t id) {
+        auto found = connections.find(id);
+        if (found != connections.end()) {
+            close(found->second.fd);  // also drops it from the epoll set
+            connections.erase(found);
+        }
+    };
+    // Writes what the socket takes; the rest waits for EPOLLOUT
+    auto flushConnection = [&](uint64_t id, Connection &connection) {
+        size_t written = 0;
+        while (written < connection.output.size()) {
+            ssize_t put = send(connection.fd, connection.output.data() + written,
+                               connection.output.size() - written, MSG_NOSIGNAL);
+            if (put < 0 && errno == EINTR) {
+                continue;
+            }
+            if (put < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                break;
+            }
+            if (put < 0) {
+                closeConnection(id);
+                return;
+            }
+            written += put;
+        }
+        connection.output.erase(0, written);
+        if (connection.output.size() > MAX_PENDING_OUTPUT) {
+            closeConnection(id);
+            return;
+        }
+        bool pending = !connection.output.empty();
+        if (pending != connection.writing) {
+            connection.writing = pending;
+            watch(connection.fd, id,
+                  (connection.peerClosed ? 0 : uint32_t(EPOLLIN)) | (pending ? uint32_t(EPOLLOUT) : 0),
+                  EPOLL_CTL_MOD);
+        }
+        if (!pending && connection.peerClosed && connection.inFlight == 0) {
+            closeConnection(id);
+        }
+    };
+
+    vector<ServerRequest> batch;
+    vector<vector<ServerRequest>> batchSlices;
+    auto dispatch = [&]() {
+        itimerspec disarm;
+        memset(&disarm, 0, sizeof(disarm));
+        timerfd_settime(timer, 0, &disarm, nullptr);
+        if (batch.empty()) {
+            return;
+        }
+        // Enough requests per slice to fill the kernel's lanes, when there is one
+        size_t perSlice = kernel ? SMALL_LANES : 1;
+        size_t numSlices = min<size_t>(numWorkers, (batch.size() + perSlice - 1) / perSlice);
+        batchSlices.assign(numSlices, vector<ServerRequest>());
+        for (size_t k = 0; k < batch.size(); ++k) {
+            batchSlices[k * numSlices / batch.size()].push_back(move(batch[k]));
+        }
+        batch.clear();
+        slices.push(batchSlices);
+        solverStats.serverBatches.fetch_add(1, memory_order_relaxed);
+    };
+    auto addRequest = [&](uint64_t id, Connection &connection, const char *begin, const char *end) {
+        long number = connection.nextRequest++;
+        ServerRequest request;
+        if (!parseScenarioLine(begin, end, problem, request.scenario)) {
+            connection.output.append("{\"scenario\":").append(to_string(number))
+                .append(",\"error\":\"malformed request\"}\n");
+            return;
+        }
+        request.connection = id;
+        request.number = number;
+        request.received = chrono::steady_clock::now();
+        ++connection.inFlight;
+        batch.push_back(move(request));
+        if (batch.size() == 1) {
+            itimerspec window;
+            memset(&window, 0, sizeof(window));
+            window.it_value.tv_sec = options.windowMicros / 1000000;
+            window.it_value.tv_nsec = (options.windowMicros % 1000000) * 1000L + 1;
+            timerfd_settime(timer, 0, &window, nullptr);
+        }
+        if (static_cast<int>(batch.size()) >= options.maxBatch) {
+            dispatch();
+        }
+    };
+    auto readConnection = [&](uint64_t id, Connection &connection) {
+        char buffer[READ_BYTES];
+        for (;;) {
+            ssize_t got = recv(connection.fd, buffer, sizeof(buffer), 0);
+            if (got < 0 && errno == EINTR) {
+                continue;
+            }
+            if (got < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                break;
+            }
+            if (got <= 0) {
+                connection.peerClosed = true;
+                watch(connection.fd, id, connection.writing ? uint32_t(EPOLLOUT) : 0, EPOLL_CTL_MOD);
+                break;
+            }
+            connection.input.append(buffer, got);
+            // Complete lines become requests as they arrive, so only the
+            // partial last line is ever buffered
+            size_t lineStart = 0;
+            for (size_t newline; (newline = connection.input.find('\n', lineStart)) != string::npos;
+                 lineStart = newline + 1) {
+                const char *begin = connection.input.data() + lineStart;
+                const char *end = connection.input.data() + newline;
+                const char *first = begin;
+                while (first < end && (*first == ' ' || *first == '\t' || *first == '\r')) {
+                    ++first;
+                }
+                if (first < end && *first != '#') {
+                    addRequest(id, connection, first, end);
+                }
+            }
+            connection.input.erase(0, lineStart);
+            if (connection.input.size() > MAX_REQUEST_BYTES) {
+                closeConnection(id);
+                return;
+            }
+        }
+        flushConnection(id, connection);
+    };
+
+    signal(SIGPIPE, SIG_IGN);
+    signal(SIGINT, onStopSignal);
+    signal(SIGTERM, onStopSignal);
+    cerr << "Serving on port " << options.port << " with " << numWorkers << " workers ("
+         << options.windowMicros << " us batch window, up to " << options.maxBatch
+         << " requests per batch)" << endl;
+
+    const int MAX_EVENTS = 256;
+    epoll_event events[MAX_EVENTS];
+    vector<Completion> done;
+    auto lastStats = chrono::steady_clock::now();
+    while (!stopServer) {
+        int numEvents = epoll_wait(poller, events, MAX_EVENTS, 1000);
+        for (int e = 0; e < numEvents; ++e) {
+            uint64_t tag = events[e].data.u64;
+            if (tag == LISTENER) {
+                for (int fd; (fd = accept4(listener, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0;) {
+                    int noDelay = 1;
+                    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+                    uint64_t id = nextConnection++;
+                    connections[id].fd = fd;
+                    watch(fd, id, EPOLLIN, EPOLL_CTL_ADD);
+                }
+            } else if (tag == BATCH_TIMER) {
+                uint64_t expirations;
+                ssize_t got = read(timer, &expirations, sizeof(expirations));
+                (void)got;
+                dispatch();
+            } else if (tag == COMPLETIONS) {
+                completions.drain(done);
+                auto now = chrono::steady_clock::now();
+                for (const Completion &completion : done) {
+                    auto found = connections.find(completion.connection);
+                    if (found == connections.end()) {
+                        continue;  // the client went away
+                    }
+                    --found->second.inFlight;
+                    formatter.writeSummary(completion.number, completion.result);
+                    formatter.drainTo(found->second.output);
+                    recordLatency(now - completion.received);
+                }
+                done.clear();
+                for (auto next = connections.begin(); next != connections.end();) {
+                    uint64_t id = next->first;
+                    Connection &connection = next->second;
+                    ++next;  // flushConnection may erase this one
+                    if (!connection.output.empty() || (connection.peerClosed && connection.inFlight == 0)) {
+                        flushConnection(id, connection);
+                    }
+                }
+            } else {
+                auto found = connections.find(tag);
+                if (found == connections.end()) {
+                    continue;
+                }
+                if (events[e].events & (EPOLLERR | EPOLLHUP)) {
+                    closeConnection(tag);
+                } else if (events[e].events & EPOLLIN) {
+                    readConnection(tag, found->second);
+                } else if (events[e].events & EPOLLOUT) {
+                    flushConnection(tag, found->second);
+                }
+            }
+        }
+
+        if (statsFile && chrono::steady_clock::now() - lastStats > chrono::seconds(10)) {
+            string error;
+            if (!writeStatsFile(statsFile, error)) {
+                cerr << "Cannot write stats: " << error << endl;
+            }
+            lastStats = chrono::steady_clock::now();
+        }
+    }
+
+    slices.close();
+    for (thread &worker : workers) {
+        worker.join();
+    }
+    for (auto &entry : connections) {
+        close(entry.second.fd);
+    }
+    close(poller);
+    close(timer);
+    close(listener);
+
+    uint64_t numRequests = solverStats.serverRequests.load();
+    uint64_t numBatches = solverStats.serverBatches.load();
+    cerr << "Served " << numRequests << " requests in " << numBatches << " batches";
+    if (numRequests > 0) {
+        cerr << ", mean latency " << solverStats.serverLatencyNanos.load() / 1.0e+3 / numRequests << " us";
+    }
+    cerr << endl;
+    return 0;
+}
+
+#else
+
+int runServer(const BlendProblem &, const ServerOptions &, int, const char *) {
+    cerr << "--serve needs Linux (epoll, eventfd, timerfd)" << endl;
+    return 1;
+}
+
+#endif
+
+
+// --- 17. MIXED-INTEGER BLEND: Minimum draws, tanks and a feed limit (CBC) ---
+
+// Plant rules the continuous model cannot express. Every feed i gets a binary
+// y_i, "feed i has a tank and is drawn from", which makes its quantity
+// semi-continuous: x_i = 0 or minDraw_i <= x_i <= U_i, through the indicator
+// rows
+//   x_i - U_i * y_i <= 0   and   x_i - minDraw_i * y_i >= 0,
+// where U_i is the smaller of the total blend and the feed's availability,
+// with sum y_i <= maxFeeds and tankCost charged per tank. Set with
+//   --mip max-feeds=3,min-draw=10,min-draw:Corn=25,tank-cost=50,gap=0.0001,seconds=60
+struct MipRules {
+    int maxFeeds = 0;           // 0 = no limit
+    double minDraw = 0.0;       // units, for feeds without a min-draw:<feed> entry
+    vector<pair<string, double>> feedMinDraw;
+    double tankCost = 0.0;      // $ per feed used
+    double gap = 1.0e-4;        // relative gap at which branch and bound stops
+    double maxSeconds = 0.0;    // 0 = no time limit
+};
+
+bool parseMipRules(const char *text, MipRules &rules) {
+    string spec(text);
+    size_t begin = 0;
+    while (begin < spec.size()) {
+        size_t end = spec.find(',', begin);
+        if (end == string::npos) {
+            end = spec.size();
+        }
+        string entry = spec.substr(begin, end - begin);
+        size_t equals = entry.find('=');
+        if (equals == string::npos) {
+            return false;
+        }
+        string key = entry.substr(0, equals);
+        const char *value = entry.c_str() + equals + 1;
+        if (key == "max-feeds") {
+            rules.maxFeeds = atoi(value);
+        } else if (key == "min-draw") {
+            rules.minDraw = atof(value);
+        } else if (key.compare(0, 9, "min-draw:") == 0 && key.size() > 9) {
+            rules.feedMinDraw.emplace_back(key.substr(9), atof(value));
+        } else if (key == "tank-cost") {
+            rules.tankCost = atof(value);
+        } else if (key == "gap") {
+            rules.gap = atof(value);
+        } else if (key == "seconds") {
+            rules.maxSeconds = atof(value);
+        } else {
+            return false;
+        }
+        begin = end + 1;
+    }
+    return rules.maxFeeds >= 0 && rules.minDraw >= 0.0 && rules.tankCost >= 0.0 &&
+           rules.gap >= 0.0 && rules.maxSeconds >= 0.0;
+}
+
+#if BLENDER_WITH_CBC
+
+struct MipReport {
+    bool feasible = false;      // an integer solution was found
+    bool optimal = false;       // ... and proven optimal within the gap
+    bool infeasible = false;    // proven to have no integer solution
+    double relaxation = NAN;    // LP relaxation (the builder's continuous model)
+    double start = NAN;         // the LP-rounded incumbent handed to CBC, NaN if none
+    double objective = NAN;
+    double bestBound = NAN;
+    double gap = NAN;           // (objective - bestBound) / |objective|
+    long nodes = 0;
+    double seconds = 0.0;       // branch and bound only
+    vector<double> quantity;    // x, one per feed
+    vector<char> used;          // y, one per feed
+};
+
+// Solves the blend under `rules`. The continuous model from buildModel() is
+// solved first, as the relaxation and as the start for everything else:
+// its largest feeds (up to maxFeeds), re-solved with their minimum draws and
+// all other feeds shut, give the first incumbent; the indicator columns and
+// rows are then added to the solved model, so CBC's root solve is a dual
+// simplex from the LP basis rather than a cold one. Branch and bound runs on
+// `numThreads` threads (CBC built with threads; otherwise serial).
+bool solveMip(const BlendProblem &problem, const MipRules &rules, int numThreads,
+              MipReport &report, string &error) {
+    int numFeeds = problem.numFeeds();
+    double total = problem.totalBlend;
+    vector<double> minDraw(numFeeds, rules.minDraw);
+    for (const auto &entry : rules.feedMinDraw) {
+        auto found = problem.feedIds.find(entry.first);
+        if (found == problem.feedIds.end()) {
+            error = "unknown feed " + entry.first;
+            return false;
+        }
+        minDraw[found->second] = entry.second;
+    }
+
+    BuildArena arena;
+    ClpSimplex model;
+    buildModel(model, problem, arena);
+    model.setLogLevel(0);
+    coldSolve(model);
+    if (!model.isProvenOptimal()) {
+        report.infeasible = model.isProvenPrimalInfeasible();
+        if (!report.infeasible) {
+            error = "the LP relaxation did not solve (status " + to_string(model.status()) + ")";
+            return false;
+        }
+        return true;
+    }
+    report.relaxation = model.getObjValue();
+
+    // LP-rounded incumbent: x, then y
+    vector<double> start;
+    {
+        const double *x = model.getColSolution();
+        vector<int> order;
+        for (int i = 0; i < numFeeds; ++i) {
+            if (x[i] > model.primalTolerance()) {
+                order.push_back(i);
+            }
+        }
+        sort(order.begin(), order.end(), [&](int a, int b) { return x[a] > x[b]; });
+        if (rules.maxFeeds > 0 && order.size() > size_t(rules.maxFeeds)) {
+            order.resize(rules.maxFeeds);
+        }
+        ClpSimplex restricted(model);
+        vector<char> kept(numFeeds, 0);
+        for (int i : order) {
+            kept[i] = 1;
+            restricted.setColumnLower(i, min(minDraw[i], total));
+        }
+        for (int i = 0; i < numFeeds; ++i) {
+            if (!kept[i]) {
+                restricted.setColumnUpper(i, 0.0);
+            }
+        }
+        {
+            BLENDER_TIME_PHASE(PHASE_SIMPLEX);
+            runSimplex(restricted, false);
+        }
+        recordSolve(restricted);
+        if (restricted.isProvenOptimal()) {
+            const double *quantity = restricted.getColSolution();
+            start.assign(quantity, quantity + numFeeds);
+            int tanks = 0;
+            for (int i = 0; i < numFeeds; ++i) {
+                bool drawn = quantity[i] > restricted.primalTolerance();
+                start.push_back(drawn ? 1.0 : 0.0);
+                tanks += drawn;
+            }
+            report.start = restricted.getObjValue() + rules.tankCost * tanks;
+        }
+    }
+
+    // Indicator columns y_i = numFeeds + i, then the indicator and
+    // cardinality rows, appended to the solved model
+    vector<double> zeros(numFeeds, 0.0), ones(numFeeds, 1.0), tankCost(numFeeds, rules.tankCost);
+    vector<CoinBigIndex> emptyStarts(numFeeds + 1, 0);
+    model.addColumns(numFeeds, zeros.data(), ones.data(), tankCost.data(), emptyStarts.data(),
+                     nullptr, nullptr);
+
+    vector<double> rowLower, rowUpper;
+    vector<CoinBigIndex> rowStarts = {0};
+    vector<int> columns;
     vector<double> elements;
+    auto addRow = [&](double lower, double upper) {
+        rowLower.push_back(lower);
+        rowUpper.push_back(upper);
+        rowStarts.push_back(columns.size());
+    };
+    for (int i = 0; i < numFeeds; ++i) {
+        columns.insert(columns.end(), {i, numFeeds + i});
+        elements.insert(elements.end(), {1.0, -min(total, problem.available[i])});
+        addRow(-1.0e+20, 0.0);
+        if (minDraw[i] > 0.0) {
+            columns.insert(columns.end(), {i, numFeeds + i});
+            elements.insert(elements.end(), {1.0, -minDraw[i]});
+            addRow(0.0, 1.0e+20);
+        }
+    }
+    if (rules.maxFeeds > 0) {
+        for (int i = 0; i < numFeeds; ++i) {
+            columns.push_back(numFeeds + i);
+            elements.push_back(1.0);
+        }
+        addRow(-1.0e+20, rules.maxFeeds);
+    }
+    model.addRows(rowLower.size(), rowLower.data(), rowUpper.data(), rowStarts.data(),
+                  columns.data(), elements.data());
 
-    // A. Total Flow Constraint (1 * x_A + 1 * x_B + 1 * x_C)
-    for (int i = 0; i < numVars; ++i) {
-        rowIndices.push_back(0); // Constraint 0
-        columnIndices.push_back(i); // Variable x_i
-        elements.push_back(1.0); // Coefficient is 1
+    OsiClpSolverInterface solver(&model, false);
+    for (int i = 0; i < numFeeds; ++i) {
+        solver.setInteger(numFeeds + i);
+    }
+    CbcModel cbc(solver);
+    cbc.setLogLevel(0);
+    cbc.setNumberThreads(numThreads > 1 ? numThreads : 0);
+    cbc.setAllowableFractionGap(rules.gap);
+    if (rules.maxSeconds > 0.0) {
+        cbc.setMaximumSeconds(rules.maxSeconds);
+    }
+    if (!start.empty()) {
+        cbc.setBestSolution(start.data(), start.size(), report.start, true);
     }
 
-    // B. Component Constraints (x_A*C_AX + x_B*C_BX + x_C*C_CX)
-    for (int j = 0; j < COMPONENTS.size(); ++j) {
-        string component = COMPONENTS[j];
-        for (int i = 0; i < numVars; ++i) {
-            rowIndices.push_back(j + 1); // Constraint 1 (X) or 2 (Y)
-            columnIndices.push_back(i); // Variable x_i
-            elements.push_back(CONTENT.at(FEEDS[i]).at(component)); 
+    auto startTime = chrono::steady_clock::now();
+    {
+        BLENDER_TIME_PHASE(PHASE_BRANCH);
+        cbc.branchAndBound();
+    }
+    report.seconds = chrono::duration<double>(chrono::steady_clock::now() - startTime).count();
+    report.nodes = cbc.getNodeCount();
+    solverStats.mipNodes.fetch_add(report.nodes, memory_order_relaxed);
+
+    const double *best = cbc.bestSolution();
+    report.feasible = best != nullptr;
+    report.optimal = report.feasible && cbc.isProvenOptimal();
+    report.infeasible = cbc.isProvenInfeasible();
+    if (report.feasible) {
+        report.objective = cbc.getObjValue();
+        report.bestBound = cbc.getBestPossibleObjValue();
+        report.gap = max(0.0, report.objective - report.bestBound) /
+                     max(fabs(report.objective), 1.0e-10);
+        solverStats.lastMipGap.store(report.gap, memory_order_relaxed);
+        report.quantity.assign(best, best + numFeeds);
+        for (int i = 0; i < numFeeds; ++i) {
+            report.used.push_back(best[numFeeds + i] > 0.5);
         }
     }
+    return true;
+}
 
-    // Add rows (constraints) to the model using the built matrix
-    model.addRows(3, rowLower, rowUpper, elements.size(), 
-                  &rowIndices[0], &columnIndices[0], &elements[0]);
+int runMip(const BlendProblem &problem, const MipRules &rules, int numThreads) {
+    MipReport report;
+    string error;
+    if (!solveMip(problem, rules, numThreads, report, error)) {
+        cerr << "Mixed-integer solve failed: " << error << endl;
+        return 1;
+    }
 
-    delete[] rowLower;
-    delete[] rowUpper;
+    cout << "Mixed-integer blend: " << problem.numFeeds() << " feeds";
+    if (rules.maxFeeds > 0) {
+        cout << ", at most " << rules.maxFeeds << " used";
+    }
+    cout << ", tank cost $" << rules.tankCost << endl;
+    cout << "LP relaxation: $" << report.relaxation << ", LP-rounded start: ";
+    if (isnan(report.start)) {
+        cout << "none" << endl;
+    } else {
+        cout << "$" << report.start << endl;
+    }
+    cout << "Branch and bound: " << report.nodes << " nodes in " << report.seconds << " s ("
+         << (report.seconds > 0.0 ? report.nodes / report.seconds : 0.0) << " nodes/s) on "
+         << numThreads << " threads" << endl;
 
-    // --- 6. SOLVE THE PROBLEM ---
+    if (!report.feasible) {
+        cout << (report.infeasible ? "Status: Infeasible" : "Status: No integer solution found")
+             << endl;
+        return 0;
+    }
+    cout << (report.optimal ? "Status: Optimal" : "Status: Stopped on a limit") << endl;
+    cout << "Minimum Total Cost: $" << report.objective << " (best bound $" << report.bestBound
+         << ", gap " << report.gap * 100.0 << "%)" << endl;
+    cout << "\nFeeds Used:" << endl;
+    for (int i = 0; i < problem.numFeeds(); ++i) {
+        if (report.used[i]) {
+            cout << "  Feed " << problem.feedNames[i] << ": " << report.quantity[i] << " units" << endl;
+        }
+    }
+    return 0;
+}
 
-    // Set the problem direction: Minimize (default) or Maximize
-    model.setObjSense(1.0); // 1.0 for minimization, -1.0 for maximization
+#else
 
-    model.initialSolve(); // Find the optimal solution
+int runMip(const BlendProblem &, const MipRules &, int) {
+    cerr << "--mip needs a -DBLENDER_WITH_CBC=1 build" << endl;
+    return 1;
+}
 
-    // --- 7. DISPLAY RESULTS ---
-    
-    if (model.isProvenOptimal()) {
-        cout << "Status: Optimal" << endl;
-        cout << "Minimum Total Cost: $" << model.getObjValue() << endl;
+#endif
 
-        const double *solution = model.getColSolution();
 
-        cout << "\nOptimal Feed Quantities:" << endl;
-        for (int i = 0; i < numVars; ++i) {
-            cout << "  Feed " << FEEDS[i] << ": " << solution[i] << " units" << endl;
+// --- 18. SUCCESSIVE LP: Nonlinear quality rows re-linearized in place ---
+
+// Qualities such as octane do not blend linearly. A component with
+// interaction terms is blended with the binary interaction model
+//   reqMin_j T  <=  Q_j(x) = sum_i c_ij x_i + (1 / T) sum_terms b x_a x_b  <=  reqMax_j T
+// where c_ij is the content fraction from the problem (the linear blending
+// value), x_a and x_b are the quantities of a pair of feeds (a == b is a
+// square term) and T is the total blend. Terms are read from a CSV file:
+//   component,feed_a,feed_b,coefficient     header
+//   RON,Reformate,Alkylate,-2.5             one term per line
+struct Interaction {
+    int component;
+    int feedA;
+    int feedB;
+    double coefficient;
+};
+
+bool loadInteractions(const char *path, const BlendProblem &problem, vector<Interaction> &terms,
+                      string &error) {
+    ifstream file(path);
+    if (!file) {
+        error = string("cannot open ") + path + ": " + strerror(errno);
+        return false;
+    }
+    string line;
+    long lineNumber = 0;
+    bool header = true;
+    vector<pair<const char *, const char *>> fields;
+    while (getline(file, line)) {
+        ++lineNumber;
+        splitCsvLine(line.data(), line.data() + line.size(), fields);
+        if (fields.size() == 1 && fields[0].first == fields[0].second) {
+            continue; // blank line
+        }
+        if (header) {
+            header = false;
+            continue;
+        }
+        auto fail = [&](const string &what) {
+            error = "line " + to_string(lineNumber) + ": " + what;
+            return false;
+        };
+        if (fields.size() != 4) {
+            return fail("expected component,feed_a,feed_b,coefficient");
+        }
+        auto field = [&](int k) { return string(fields[k].first, fields[k].second); };
+        auto component = problem.componentIds.find(field(0));
+        if (component == problem.componentIds.end()) {
+            return fail("unknown component " + field(0));
+        }
+        auto feedA = problem.feedIds.find(field(1));
+        auto feedB = problem.feedIds.find(field(2));
+        if (feedA == problem.feedIds.end() || feedB == problem.feedIds.end()) {
+            return fail("unknown feed " + (feedA == problem.feedIds.end() ? field(1) : field(2)));
+        }
+        double coefficient;
+        if (!parseNumber(fields[3].first, fields[3].second, coefficient)) {
+            return fail("bad coefficient");
+        }
+        terms.push_back(Interaction{component->second, feedA->second, feedB->second, coefficient});
+    }
+    return true;
+}
+
+const int SLP_MAX_ITERATIONS = 100;
+const double SLP_TOLERANCE = 1.0e-7;     // predicted merit decrease, relative, at which SLP stops
+const double SLP_INITIAL_STEP = 0.25;    // trust region radius, as a fraction of the total blend
+const double SLP_PENALTY_FACTOR = 1.0e4; // $ per unit of spec violation, times (1 + largest cost)
+
+struct SlpStep {
+    double objective;   // cost of the blend after the step (accepted or not)
+    double violation;   // largest nonlinear spec shortfall or excess, as a fraction
+    double radius;      // trust region radius the step was taken in
+    bool accepted;
+    int iterations;     // simplex iterations of the re-solve
+    double seconds;
+};
+
+struct SlpReport {
+    vector<SlpStep> history;
+    bool converged = false;
+    double objective = 0.0;
+    double violation = 0.0;
+    vector<double> quantity;       // x, one per feed
+    vector<double> quality;        // Q_j / T, one per component
+    double updateSeconds = 0.0;    // re-linearizing rows in the live model
+    double solveSeconds = 0.0;     // warm re-solves
+};
+
+// Minimizes cost under the nonlinear specs by successive linear programming
+// on one live ClpSimplex. Each iteration re-linearizes the rows of the
+// nonlinear components around the current blend x^k: feed i's coefficient
+// becomes the gradient c_ij + (1 / T) sum b x_other^k, written in place with
+// modifyCoefficient(), and both row bounds (reqMin_j T and reqMax_j T) move
+// by (1 / T) sum b x_a^k x_b^k. Nothing else in the model changes
+// apart from the trust region |x_i - x_i^k| <= radius on the column bounds,
+// so the re-solve is a dual simplex from the previous basis.
+//
+// Elastic columns per nonlinear row (one for the minimum, one for a finite
+// maximum), priced at a large penalty, keep every linearization feasible;
+// steps are judged on the exact penalty merit
+// cost + penalty * (shortfall + excess) and the radius grows or shrinks with how well
+// the LP predicted its decrease.
+bool solveSlp(const BlendProblem &problem, const vector<Interaction> &terms, SlpReport &report,
+              string &error) {
+    int numFeeds = problem.numFeeds();
+    double total = problem.totalBlend;
+    if (total <= 0.0) {
+        error = "successive LP needs a positive total blend";
+        return false;
+    }
+
+    // Row pattern of each nonlinear component: feeds with content or a term
+    vector<int> components;
+    for (const Interaction &term : terms) {
+        components.push_back(term.component);
+    }
+    sort(components.begin(), components.end());
+    components.erase(unique(components.begin(), components.end()), components.end());
+    vector<vector<int>> pattern(components.size());
+    vector<vector<double>> linear(components.size(), vector<double>(numFeeds, 0.0));
+    vector<vector<const Interaction *>> rowTerms(components.size());
+    for (size_t r = 0; r < components.size(); ++r) {
+        int j = components[r];
+        for (int i = 0; i < numFeeds; ++i) {
+            linear[r][i] = problem.contentOf(i, j);
+        }
+        vector<char> inRow(numFeeds, 0);
+        for (int i = 0; i < numFeeds; ++i) {
+            inRow[i] = linear[r][i] != 0.0;
+        }
+        for (const Interaction &term : terms) {
+            if (term.component == j) {
+                rowTerms[r].push_back(&term);
+                inRow[term.feedA] = inRow[term.feedB] = 1;
+            }
+        }
+        for (int i = 0; i < numFeeds; ++i) {
+            if (inRow[i]) {
+                pattern[r].push_back(i);
+            }
+        }
+    }
+
+    auto quality = [&](size_t r, const double *x) {
+        double value = 0.0;
+        for (int i : pattern[r]) {
+            value += linear[r][i] * x[i];
+        }
+        for (const Interaction *term : rowTerms[r]) {
+            value += term->coefficient * x[term->feedA] * x[term->feedB] / total;
+        }
+        return value;
+    };
+    // How far quality(r, x) is below the minimum plus how far it is above the maximum
+    auto shortfall = [&](size_t r, const double *x) {
+        double value = quality(r, x);
+        return max(0.0, problem.reqMin[components[r]] * total - value) +
+               max(0.0, value - perBlend(problem.reqMax[components[r]], total));
+    };
+    double largestCost = 0.0;
+    for (double cost : problem.cost) {
+        largestCost = max(largestCost, fabs(cost));
+    }
+    double penalty = SLP_PENALTY_FACTOR * (1.0 + largestCost);
+    auto merit = [&](const double *x) {
+        double value = 0.0;
+        for (int i = 0; i < numFeeds; ++i) {
+            value += problem.cost[i] * x[i];
+        }
+        for (size_t r = 0; r < components.size(); ++r) {
+            value += penalty * shortfall(r, x);
+        }
+        return value;
+    };
+    auto violation = [&](const double *x) {
+        double worst = 0.0;
+        for (size_t r = 0; r < components.size(); ++r) {
+            worst = max(worst, shortfall(r, x) / total);
+        }
+        return worst;
+    };
+
+    // The linear model (interactions ignored) plus the elastic columns gives x^0
+    BuildArena arena;
+    ClpSimplex model;
+    buildModel(model, problem, arena);
+    model.setLogLevel(0);
+    for (int j : components) {
+        int row = j + 1; // row j + 1 is component j (see buildModel)
+        double one = 1.0;
+        model.addColumn(1, &row, &one, 0.0, 1.0e+20, penalty);
+        if (problem.reqMax[j] < 1.0e+20) {
+            double minusOne = -1.0;
+            model.addColumn(1, &row, &minusOne, 0.0, 1.0e+20, penalty);
+        }
+    }
+    coldSolve(model);
+    if (!model.isProvenOptimal()) {
+        error = "the linear blend did not solve (status " + to_string(model.status()) + ")";
+        return false;
+    }
+    vector<double> x(model.getColSolution(), model.getColSolution() + numFeeds);
+    double currentMerit = merit(x.data());
+    double radius = SLP_INITIAL_STEP * total;
+    vector<double> gradient(numFeeds);
+
+    for (int iteration = 0; iteration < SLP_MAX_ITERATIONS; ++iteration) {
+        auto startTime = chrono::steady_clock::now();
+        for (size_t r = 0; r < components.size(); ++r) {
+            int row = components[r] + 1;
+            double offset = 0.0;
+            for (int i : pattern[r]) {
+                gradient[i] = linear[r][i];
+            }
+            for (const Interaction *term : rowTerms[r]) {
+                gradient[term->feedA] += term->coefficient * x[term->feedB] / total;
+                gradient[term->feedB] += term->coefficient * x[term->feedA] / total;
+                offset += term->coefficient * x[term->feedA] * x[term->feedB] / total;
+            }
+            // keepZero: an element whose gradient passes through 0 stays in
+            // the matrix, so every later update is an in-place overwrite
+            for (int i : pattern[r]) {
+                model.modifyCoefficient(row, i, gradient[i], true);
+            }
+            double upper = perBlend(problem.reqMax[components[r]], total);
+            model.setRowBounds(row, problem.reqMin[components[r]] * total + offset,
+                               upper < 1.0e+20 ? upper + offset : upper);
+        }
+        for (int i = 0; i < numFeeds; ++i) {
+            model.setColumnBounds(i, max(0.0, x[i] - radius),
+                                  min(problem.available[i], x[i] + radius));
+        }
+        auto solveTime = chrono::steady_clock::now();
+        report.updateSeconds += chrono::duration<double>(solveTime - startTime).count();
+
+        warmSolve(model, CHANGED_BOUNDS | CHANGED_COEFFICIENTS);
+        auto endTime = chrono::steady_clock::now();
+        report.solveSeconds += chrono::duration<double>(endTime - solveTime).count();
+        if (!model.isProvenOptimal()) {
+            error = "linearization " + to_string(iteration + 1) + " did not solve (status " +
+                    to_string(model.status()) + ")";
+            return false;
+        }
+
+        // The LP objective is the linearized merit, which is exact at x^k
+        const double *next = model.getColSolution();
+        double predicted = currentMerit - model.getObjValue();
+        double nextMerit = merit(next);
+        double step = 0.0;
+        for (int i = 0; i < numFeeds; ++i) {
+            step = max(step, fabs(next[i] - x[i]));
+        }
+        double ratio = predicted > 0.0 ? (currentMerit - nextMerit) / predicted : 0.0;
+        bool accepted = ratio > 0.0;
+
+        SlpStep record;
+        record.objective = nextMerit;
+        for (size_t r = 0; r < components.size(); ++r) {
+            record.objective -= penalty * shortfall(r, next);
+        }
+        record.violation = violation(next);
+        record.radius = radius;
+        record.accepted = accepted;
+        record.iterations = model.numberIterations();
+        record.seconds = chrono::duration<double>(endTime - startTime).count();
+        report.history.push_back(record);
+
+        if (predicted <= SLP_TOLERANCE * (1.0 + fabs(currentMerit))) {
+            report.converged = true;
+            break;
+        }
+        if (accepted) {
+            x.assign(next, next + numFeeds);
+            currentMerit = nextMerit;
+        }
+        if (ratio < 0.25) {
+            radius *= 0.5;
+        } else if (ratio > 0.75 && step >= 0.99 * radius) {
+            radius *= 2.0;
+        }
+        if (radius < SLP_TOLERANCE * total) {
+            report.converged = true; // no step left that the LP can improve on
+            break;
+        }
+    }
+
+    report.quantity = x;
+    report.objective = 0.0;
+    for (int i = 0; i < numFeeds; ++i) {
+        report.objective += problem.cost[i] * x[i];
+    }
+    report.violation = violation(x.data());
+    report.quality.resize(problem.numComponents());
+    for (int j = 0; j < problem.numComponents(); ++j) {
+        double value = 0.0;
+        for (int i = 0; i < numFeeds; ++i) {
+            value += problem.contentOf(i, j) * x[i];
+        }
+        report.quality[j] = value / total;
+    }
+    for (size_t r = 0; r < components.size(); ++r) {
+        report.quality[components[r]] = quality(r, x.data()) / total;
+    }
+    return true;
+}
+
+int runSlp(const BlendProblem &problem, const char *interactionFile) {
+    vector<Interaction> terms;
+    string error;
+    if (!loadInteractions(interactionFile, problem, terms, error)) {
+        cerr << "Cannot load " << interactionFile << ": " << error << endl;
+        return 1;
+    }
+    SlpReport report;
+    if (!solveSlp(problem, terms, report, error)) {
+        cerr << "Successive LP failed: " << error << endl;
+        return 1;
+    }
+
+    cout << "Iteration\tObjective\tViolation\tRadius\tAccepted\tIterations\tSeconds" << endl;
+    for (size_t n = 0; n < report.history.size(); ++n) {
+        const SlpStep &step = report.history[n];
+        cout << n + 1 << "\t" << step.objective << "\t" << step.violation << "\t" << step.radius
+             << "\t" << (step.accepted ? "yes" : "no") << "\t" << step.iterations << "\t"
+             << step.seconds << "\n";
+    }
+    cout << "Successive LP: " << (report.converged ? "converged" : "iteration limit") << " after "
+         << report.history.size() << " linearizations (" << terms.size()
+         << " interaction terms; updates " << report.updateSeconds << " s, re-solves "
+         << report.solveSeconds << " s)" << endl;
+    if (report.violation > SLP_TOLERANCE) {
+        cout << "Status: Nonlinear specs violated by up to " << report.violation << endl;
+    } else {
+        cout << "Status: Optimal (local)" << endl;
+    }
+    cout << "Minimum Total Cost: $" << report.objective << endl;
+    cout << "\nFeed Quantities:" << endl;
+    for (int i = 0; i < problem.numFeeds(); ++i) {
+        cout << "  Feed " << problem.feedNames[i] << ": " << report.quantity[i] << " units" << endl;
+    }
+    cout << "\nBlended Qualities (minimum):" << endl;
+    for (int j = 0; j < problem.numComponents(); ++j) {
+        cout << "  Component " << problem.componentNames[j] << ": " << report.quality[j] << " ("
+             << problem.reqMin[j] << ")" << endl;
+    }
+    return 0;
+}
+
+#endif
+
+
+int main(int argc, char **argv) {
+#if BLENDER_EMBEDDED
+    (void)argc;
+    (void)argv;
+    return runEmbedded();
+#else
+    solverStats.startClock();
+
+    // Batch mode: lp_blender --batch [file|-] [--cold] [--threads n]
+    // Across the ranks of an MPI job: mpirun -n ranks lp_blender --batch file --distributed
+    // Content fractions at or below --drop-tolerance are left out of the matrix
+    // Live mode: lp_blender --live (update commands on stdin)
+    // Benchmark: lp_blender --bench key=value,... [--bench-out report.json]
+    bool batch = false;
+    bool bench = false;
+    BenchOptions benchOptions;
+    const char *benchReport = nullptr;
+    bool live = false;
+    bool embedded = false;  // --embedded: the BLENDER_EMBEDDED path
+    double dropTolerance = 0.0;
+    bool cold = false;
+    bool distributed = false;
+    int numThreads = 1; // 0 = one per hardware thread
+    // Problem data: --data file (CSV or binary) instead of the compiled-in
+    // example; --save-binary writes the loaded problem in binary form
+    const char *dataFile = nullptr;
+    const char *binaryFile = nullptr;
+    // Results: --output table (default) or --output ndjson
+    OutputFormat format = OUTPUT_TABLE;
+    // Result archive: --archive file (batch solutions), --archive-get file id
+    const char *archiveFile = nullptr;
+    const char *archiveLookup = nullptr;
+    uint64_t archiveId = 0;
+    // Timers and solver counters: --stats file (Prometheus text format)
+    const char *statsFile = nullptr;
+    // Presolve and scaling: --no-presolve, --presolve-cache [check], --scaling 0..3
+    // Batch result cache: --result-cache MB (exact hits skip the solve),
+    // --compact-results for sparse and 2-bit packed entries and float32 content
+    // Basis store for single and multi-period solves: --basis-dir dir
+    // Stall remedies after --stall-iterations n iterations without progress (0 = off)
+    // Cold-solve algorithm: --algorithm auto|dual|primal|barrier|pdlp, --barrier-threads n
+    // Racing solve of the single or multi-period model: --race [entrants]
+    // Sensitivity of the single solve: --ranging, and
+    // --parametric feed low high [points] for the cost curve of one feed
+    bool ranging = false;
+    // Multi-period model: --multi products periods (built on --threads threads)
+    int multiProducts = 0, multiPeriods = 0;
+    bool decompose = false;
+    // Mixed-integer blend: --mip [key=value,...] (see MipRules; --threads for CBC)
+    bool mip = false;
+    MipRules mipRules;
+    // Nonlinear qualities by successive LP: --slp interactions.csv (see Interaction)
+    const char *interactionFile = nullptr;
+    // Solve service: --serve [port] [--batch-window us] [--max-batch n] (--threads workers)
+    bool serve = false;
+    ServerOptions serverOptions;
+    const char *parametricFeed = nullptr;
+    double parametricLow = 0.0, parametricHigh = 0.0;
+    int parametricPoints = 0;
+    const char *scenarioFile = "-";
+    for (int arg = 1; arg < argc; ++arg) {
+        if (strcmp(argv[arg], "--batch") == 0) {
+            batch = true;
+            if (arg + 1 < argc && argv[arg + 1][0] != '-') {
+                scenarioFile = argv[++arg];
+            } else if (arg + 1 < argc && strcmp(argv[arg + 1], "-") == 0) {
+                ++arg;
+            }
+        } else if (strcmp(argv[arg], "--bench") == 0) {
+            bench = true;
+            if (arg + 1 < argc && argv[arg + 1][0] != '-' &&
+                !parseBenchOptions(argv[++arg], benchOptions)) {
+                cerr << "Bad benchmark options: " << argv[arg] << endl;
+                return 1;
+            }
+        } else if (strcmp(argv[arg], "--bench-out") == 0 && arg + 1 < argc) {
+            benchReport = argv[++arg];
+        } else if (strcmp(argv[arg], "--live") == 0) {
+            live = true;
+        } else if (strcmp(argv[arg], "--cold") == 0) {
+            cold = true;
+        } else if (strcmp(argv[arg], "--distributed") == 0) {
+#if !BLENDER_WITH_MPI
+            cerr << "--distributed needs a -DBLENDER_WITH_MPI=1 build" << endl;
+            return 1;
+#endif
+            distributed = true;
+        } else if (strcmp(argv[arg], "--threads") == 0 && arg + 1 < argc) {
+            numThreads = atoi(argv[++arg]);
+        } else if (strcmp(argv[arg], "--drop-tolerance") == 0 && arg + 1 < argc) {
+            dropTolerance = atof(argv[++arg]);
+        } else if (strcmp(argv[arg], "--output") == 0 && arg + 1 < argc &&
+                   (strcmp(argv[arg + 1], "table") == 0 || strcmp(argv[arg + 1], "ndjson") == 0)) {
+            format = strcmp(argv[++arg], "ndjson") == 0 ? OUTPUT_NDJSON : OUTPUT_TABLE;
+        } else if (strcmp(argv[arg], "--multi") == 0 && arg + 2 < argc) {
+            multiProducts = atoi(argv[++arg]);
+            multiPeriods = atoi(argv[++arg]);
+            if (multiProducts <= 0 || multiPeriods <= 0) {
+                cerr << "--multi needs positive product and period counts" << endl;
+                return 1;
+            }
+        } else if (strcmp(argv[arg], "--serve") == 0) {
+            serve = true;
+            if (arg + 1 < argc && argv[arg + 1][0] != '-') {
+                serverOptions.port = atoi(argv[++arg]);
+            }
+        } else if (strcmp(argv[arg], "--batch-window") == 0 && arg + 1 < argc) {
+            serverOptions.windowMicros = max(0, atoi(argv[++arg]));
+        } else if (strcmp(argv[arg], "--max-batch") == 0 && arg + 1 < argc) {
+            serverOptions.maxBatch = max(1, atoi(argv[++arg]));
+        } else if (strcmp(argv[arg], "--decompose") == 0) {
+            decompose = true;
+        } else if (strcmp(argv[arg], "--ranging") == 0) {
+            ranging = true;
+        } else if (strcmp(argv[arg], "--parametric") == 0 && arg + 3 < argc) {
+            parametricFeed = argv[++arg];
+            parametricLow = atof(argv[++arg]);
+            parametricHigh = atof(argv[++arg]);
+            if (arg + 1 < argc && argv[arg + 1][0] != '-') {
+                parametricPoints = atoi(argv[++arg]);
+            }
+        } else if (strcmp(argv[arg], "--no-presolve") == 0) {
+            solveOptions.presolve = false;
+        } else if (strcmp(argv[arg], "--presolve-cache") == 0) {
+            solveOptions.presolveCache = true;
+            if (arg + 1 < argc && strcmp(argv[arg + 1], "check") == 0) {
+                solveOptions.checkPresolveCache = true;
+                ++arg;
+            }
+        } else if (strcmp(argv[arg], "--archive") == 0 && arg + 1 < argc) {
+            archiveFile = argv[++arg];
+        } else if (strcmp(argv[arg], "--archive-get") == 0 && arg + 2 < argc) {
+            archiveLookup = argv[++arg];
+            archiveId = strtoull(argv[++arg], nullptr, 10);
+        } else if (strcmp(argv[arg], "--embedded") == 0) {
+            embedded = true;
+        } else if (strcmp(argv[arg], "--result-cache") == 0 && arg + 1 < argc) {
+            solveOptions.resultCacheBytes = static_cast<size_t>(atof(argv[++arg]) * (1 << 20));
+        } else if (strcmp(argv[arg], "--compact-results") == 0) {
+            solveOptions.compactResults = true;
+        } else if (strcmp(argv[arg], "--stall-iterations") == 0 && arg + 1 < argc) {
+            solveOptions.stallIterations = atoi(argv[++arg]);
+        } else if (strcmp(argv[arg], "--basis-dir") == 0 && arg + 1 < argc) {
+            solveOptions.basisDir = argv[++arg];
+        } else if (strcmp(argv[arg], "--algorithm") == 0 && arg + 1 < argc) {
+            const char *name = argv[++arg];
+            int algorithm = ALGORITHM_AUTO;
+            while (algorithm < NUM_ALGORITHMS && strcmp(name, ALGORITHM_NAMES[algorithm]) != 0) {
+                ++algorithm;
+            }
+            if (algorithm == NUM_ALGORITHMS) {
+                cerr << "Unknown --algorithm " << name << " (auto, dual, primal, barrier or pdlp)"
+                     << endl;
+                return 1;
+            }
+#if !BLENDER_WITH_CUDA
+            if (algorithm == ALGORITHM_PDLP) {
+                cerr << "--algorithm pdlp needs a -DBLENDER_WITH_CUDA=1 build" << endl;
+                return 1;
+            }
+#endif
+            solveOptions.algorithm = static_cast<Algorithm>(algorithm);
+        } else if (strcmp(argv[arg], "--barrier-threads") == 0 && arg + 1 < argc) {
+            solveOptions.barrierThreads = atoi(argv[++arg]);
+#if !BLENDER_WITH_PARDISO
+            cerr << "Note: --barrier-threads needs a -DBLENDER_WITH_PARDISO=1 build;"
+                 << " the native Cholesky runs on one thread" << endl;
+#endif
+        } else if (strcmp(argv[arg], "--race") == 0) {
+            solveOptions.racers = 3;
+            if (arg + 1 < argc && argv[arg + 1][0] != '-') {
+                solveOptions.racers = min(atoi(argv[++arg]), NUM_RACE_VARIANTS);
+            }
+        } else if (strcmp(argv[arg], "--mip") == 0) {
+            mip = true;
+            if (arg + 1 < argc && argv[arg + 1][0] != '-' && !parseMipRules(argv[++arg], mipRules)) {
+                cerr << "Bad mixed-integer rules: " << argv[arg] << endl;
+                return 1;
+            }
+        } else if (strcmp(argv[arg], "--slp") == 0 && arg + 1 < argc) {
+            interactionFile = argv[++arg];
+        } else if (strcmp(argv[arg], "--small-kernel") == 0) {
+            solveOptions.smallKernel = true;
+        } else if (strcmp(argv[arg], "--scaling") == 0 && arg + 1 < argc) {
+            solveOptions.scaling = atoi(argv[++arg]);
+        } else if (strcmp(argv[arg], "--stats") == 0 && arg + 1 < argc) {
+            statsFile = argv[++arg];
+        } else if (strcmp(argv[arg], "--data") == 0 && arg + 1 < argc) {
+            dataFile = argv[++arg];
+        } else if (strcmp(argv[arg], "--save-binary") == 0 && arg + 1 < argc) {
+            binaryFile = argv[++arg];
+        } else {
+            cerr << "Usage: " << argv[0]
+                 << " [--data file] [--save-binary file] [--drop-tolerance value]"
+                 << " [--output table|ndjson] [--stats file]"
+                 << " [--no-presolve] [--presolve-cache [check]] [--scaling 0-3] [--basis-dir dir]"
+                 << " [--stall-iterations n]"
+                 << " [--algorithm auto|dual|primal|barrier|pdlp] [--barrier-threads n]"
+                 << " [--race [n]]"
+                 << " [--ranging] [--parametric feed low high [points]]"
+                 << " [--multi products periods [--decompose]] [--mip [key=value,...]]"
+                 << " [--slp file] [--embedded]"
+                 << " [--batch [file|-] [--cold] [--threads n] [--small-kernel] [--result-cache MB]"
+                 << " [--compact-results] [--archive file] [--distributed]"
+                 << " | --archive-get file id"
+                 << " | --live | --serve [port] [--batch-window us] [--max-batch n]"
+                 << " | --bench [key=value,...] [--bench-out file]]" << endl;
+            return 1;
+        }
+    }
+
+    if (distributed) {
+        if (!batch || strcmp(scenarioFile, "-") == 0) {
+            cerr << "--distributed needs --batch with a scenario file" << endl;
+            return 1;
+        }
+#if BLENDER_WITH_MPI
+        return runDistributedBatch(dataFile, dropTolerance, scenarioFile, numThreads, cold,
+                                   archiveFile, statsFile);
+#endif
+    }
+
+    StatsFileWriter statsWriter(statsFile);
+
+    if (embedded) {
+        return runEmbedded();
+    }
+
+    if (bench) {
+        return runBenchmark(benchOptions, benchReport, dropTolerance);
+    }
+
+    BlendProblem problem;
+    problem.dropTolerance = dropTolerance;
+    if (dataFile) {
+        string error;
+        if (!loadProblemFile(dataFile, problem, error)) {
+            cerr << "Cannot load " << dataFile << ": " << error << endl;
+            return 1;
         }
     } else {
-        cout << "Status: Not Optimal (" << model.status() << ")" << endl;
+        problem = exampleProblem();
+        problem.dropTolerance = dropTolerance;
+    }
+    if (binaryFile) {
+        string error;
+        if (!writeBinaryProblem(binaryFile, problem, error)) {
+            cerr << "Cannot save " << binaryFile << ": " << error << endl;
+            return 1;
+        }
+    }
+
+    if (numThreads <= 0) {
+        numThreads = max(1u, thread::hardware_concurrency());
+    }
+    unique_ptr<SolveCache> cache;  // behind resultCache
+    if (solveOptions.resultCacheBytes > 0) {
+        cache.reset(new SolveCache(solveOptions.resultCacheBytes, solveOptions.compactResults));
+        resultCache = cache.get();
+        if (solveOptions.compactResults) {
+            problem.narrowContent();
+        }
+    }
+
+    if (archiveLookup) {
+        return runArchiveLookup(archiveLookup, archiveId, problem);
+    }
+
+    if (live) {
+        return runLive(problem);
+    }
+
+    if (serve) {
+        return runServer(problem, serverOptions, numThreads, statsFile);
+    }
+
+    if (mip) {
+        return runMip(problem, mipRules, numThreads);
+    }
+
+    if (interactionFile) {
+        return runSlp(problem, interactionFile);
+    }
+
+    if (multiProducts > 0) {
+        if (decompose) {
+            return runDecomposition(problem, multiProducts, multiPeriods, numThreads);
+        }
+        return runMultiPeriod(problem, multiProducts, multiPeriods, numThreads);
+    }
+
+    if (batch) {
+        ifstream file;
+        if (strcmp(scenarioFile, "-") != 0) {
+            file.open(scenarioFile);
+            if (!file) {
+                cerr << "Cannot open scenario file " << scenarioFile << endl;
+                return 1;
+            }
+        }
+        istream &in = file.is_open() ? static_cast<istream &>(file) : cin;
+        ResultWriter writer(format);
+        if (numThreads > 1 || solveOptions.smallKernel) {
+            return runParallelBatch(in, problem, numThreads, cold, writer, archiveFile);
+        }
+        return runBatch(in, problem, cold, writer, archiveFile);
+    }
+
+    // 2. INITIALIZE THE SOLVER
+    BuildArena arena;
+    ClpSimplex model;
+    buildModel(model, problem, arena);
+
+    // --- 6. SOLVE THE PROBLEM ---
+
+    solveWithBasisStore(model); // Find the optimal solution
+
+    // --- 7. DISPLAY RESULTS ---
+
+    ResultWriter writer(format);
+    writer.writeSolution(-1, model, problem);
+
+    if (ranging && model.isProvenOptimal()) {
+        writer.writeRanging(rangeModel(model), problem);
+    }
+    if (parametricFeed && model.isProvenOptimal()) {
+        auto found = problem.feedIds.find(parametricFeed);
+        if (found == problem.feedIds.end() || parametricHigh < parametricLow) {
+            writer.flush();
+            cerr << "Bad --parametric feed or price range" << endl;
+            return 1;
+        }
+        writer.writeCostCurve(parametricFeed,
+                              costCurve(model, found->second, parametricLow, parametricHigh),
+                              parametricPoints);
     }
 
     return 0;
+#endif
 }
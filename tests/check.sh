@@ -0,0 +1,287 @@
+#!/usr/bin/env bash
+# Regression checks for lp_blender, run against a built binary and,
+# optionally, a -DBLENDER_EMBEDDED=1 build of it:
+#   tests/check.sh path/to/lp_blender [path/to/lp_blender_embedded]
+# Problem data and scenarios come from tests/data; example.csv is the
+# compiled-in example, so every path is expected to find the same optimum
+# (A 40, B 40, C 20 at $1040 for the base scenario).
+set -u
+
+BLENDER=$1
+EMBEDDED=${2:-}
+DATA=$(cd "$(dirname "$0")/data" && pwd)
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+failures=0
+
+pass() { echo "ok   - $1"; }
+fail() { echo "FAIL - $1"; failures=$((failures + 1)); }
+
+# Objectives of data/scenarios.txt, as "scenario objective" pairs
+EXPECTED="1 1040 2 1000 3 2200"
+
+# objectives_match FILE [EXPECTED [TOLERANCE]]: the NDJSON summaries in FILE
+# are all optimal, cover every expected scenario and agree with it to a
+# relative TOLERANCE (1e-6)
+objectives_match() {
+    awk -v expected="${2:-$EXPECTED}" -v tolerance="${3:-1.0e-6}" '
+        BEGIN { n = split(expected, e, " "); for (k = 1; k < n; k += 2) want[e[k]] = e[k + 1] }
+        /^\{"scenario":/ {
+            line = $0
+            gsub(/[{}"]/, "", line)
+            m = split(line, fields, ",")
+            delete f
+            for (k = 1; k <= m; ++k) { split(fields[k], kv, ":"); f[kv[1]] = kv[2] }
+            s = f["scenario"]
+            if (!(s in want) || f["status"] != 0) { bad = 1; next }
+            d = f["objective"] - want[s]
+            if (d < 0) d = -d
+            if (d > tolerance * want[s]) bad = 1
+            seen[s] = 1
+        }
+        END { for (s in want) if (!(s in seen)) bad = 1; exit bad }' "$1"
+}
+
+# poke FILE OFFSET BYTES: overwrites bytes (printf escapes) in place
+poke() {
+    printf "$3" | dd of="$1" bs=1 seek="$2" conv=notrunc status=none
+}
+
+# --- Binary problem files (--data, --save-binary) ---
+check_loader() {
+    if "$BLENDER" --data "$DATA/example.csv" > "$WORK/single.txt" 2>&1 &&
+       awk -F'$' '/^Minimum Total Cost:/ { d = $2 - 1040; found = d < 1.0e-6 && d > -1.0e-6 }
+                  END { exit !found }' "$WORK/single.txt"; then
+        pass "CSV single solve"
+    else
+        fail "CSV single solve (see below)"
+        cat "$WORK/single.txt"
+    fi
+
+    "$BLENDER" --data "$DATA/example.csv" --save-binary "$WORK/example.bin" \
+        --batch "$DATA/scenarios.txt" --output ndjson > "$WORK/csv.ndjson" 2> /dev/null
+    "$BLENDER" --data "$WORK/example.bin" \
+        --batch "$DATA/scenarios.txt" --output ndjson > "$WORK/binary.ndjson" 2> /dev/null
+    if objectives_match "$WORK/csv.ndjson" && objectives_match "$WORK/binary.ndjson"; then
+        pass "CSV and binary batch"
+    else
+        fail "CSV and binary batch"
+    fi
+
+    # Damaged files must be refused, not solved
+    head -c 100 "$WORK/example.bin" > "$WORK/truncated.bin"
+    cp "$WORK/example.bin" "$WORK/components.bin"
+    poke "$WORK/components.bin" 12 '\377\377\377\177'  # numComponents
+    cp "$WORK/example.bin" "$WORK/content.bin"
+    local contentComponents
+    contentComponents=$(od -An -tu8 -j56 -N8 "$WORK/example.bin" | tr -d ' ')
+    poke "$WORK/content.bin" "$contentComponents" '\007\000\000\000'  # component 7 of 2
+    local zeros
+    zeros=$(printf '0%.0s' $(seq 130))
+    sed "s/^A,10.0,/A,1$zeros,/" "$DATA/example.csv" > "$WORK/long-number.csv"
+    local damaged
+    for damaged in truncated.bin components.bin content.bin long-number.csv; do
+        if "$BLENDER" --data "$WORK/$damaged" > "$WORK/damaged.txt" 2>&1 ||
+           ! grep -q "^Cannot load" "$WORK/damaged.txt"; then
+            fail "refuses $damaged"
+        else
+            pass "refuses $damaged"
+        fi
+    done
+}
+
+# --- Result cache (--result-cache, --compact-results) ---
+check_result_cache() {
+    # Tight enough to tell 1040.000002 from 1040
+    local expected="1 1040 2 1040 3 1040.000002 4 1040.000002 5 1000 6 1040"
+    local compact
+    for compact in "" --compact-results; do
+        "$BLENDER" --data "$DATA/example.csv" --batch "$DATA/repeats.txt" --result-cache 1 \
+            $compact --output ndjson > "$WORK/cache.ndjson" 2> /dev/null
+        if objectives_match "$WORK/cache.ndjson" "$expected" 1.0e-10; then
+            pass "result cache ${compact:-dense}"
+        else
+            fail "result cache ${compact:-dense}"
+            cat "$WORK/cache.ndjson"
+        fi
+    done
+}
+
+# counter FILE NAME: the value of a counter in a --stats file
+counter() {
+    awk -v name="$2" '$1 == name { print $2 }' "$1"
+}
+
+# --- Presolve cache (--presolve-cache check) ---
+check_presolve_cache() {
+    "$BLENDER" --data "$DATA/example.csv" --batch "$DATA/scenarios.txt" \
+        --presolve-cache check --output ndjson > "$WORK/presolve.ndjson" 2> /dev/null
+    if objectives_match "$WORK/presolve.ndjson"; then
+        pass "presolve cache"
+    else
+        fail "presolve cache"
+    fi
+
+    # Every cached solve is compared with a fresh one; the scenario the
+    # cache does not cover is presolved again rather than refused
+    "$BLENDER" --data "$DATA/presolve.csv" --batch "$DATA/presolve-scenarios.txt" \
+        --presolve-cache check --output ndjson --stats "$WORK/presolve.prom" \
+        > "$WORK/presolve.ndjson" 2> /dev/null
+    local mismatches rebuilds
+    mismatches=$(counter "$WORK/presolve.prom" blender_presolve_cache_mismatches_total 2> /dev/null)
+    rebuilds=$(counter "$WORK/presolve.prom" blender_presolve_cache_rebuilds_total 2> /dev/null)
+    if objectives_match "$WORK/presolve.ndjson" "1 1040 2 1000 3 1100 4 1050" &&
+       [ "${mismatches:-1}" -eq 0 ] && [ "${rebuilds:-0}" -ge 1 ]; then
+        pass "presolve cache rebuild"
+    else
+        fail "presolve cache rebuild (see below)"
+        cat "$WORK/presolve.ndjson"
+        grep '^blender_presolve_cache' "$WORK/presolve.prom" 2> /dev/null
+    fi
+}
+
+# --- Result archive (--archive, --archive-get) ---
+check_archive() {
+    "$BLENDER" --data "$DATA/example.csv" --batch "$DATA/scenarios.txt" \
+        --archive "$WORK/a.bin" > /dev/null 2>&1
+    if "$BLENDER" --data "$DATA/example.csv" --archive-get "$WORK/a.bin" 2 \
+           > "$WORK/archived.txt" 2>&1 &&
+       awk -F'$' '/^Minimum Total Cost:/ { d = $2 - 1000; found = d < 1.0e-6 && d > -1.0e-6 }
+                  END { exit !found }' "$WORK/archived.txt"; then
+        pass "archive round trip"
+    else
+        fail "archive round trip (see below)"
+        cat "$WORK/archived.txt"
+    fi
+
+    head -c "$(( $(wc -c < "$WORK/a.bin") / 2 ))" "$WORK/a.bin" > "$WORK/truncated-archive.bin"
+    if "$BLENDER" --data "$DATA/example.csv" --archive-get "$WORK/truncated-archive.bin" 2 \
+           > "$WORK/archived.txt" 2>&1 ||
+       ! grep -q "^Cannot read result archive" "$WORK/archived.txt"; then
+        fail "refuses a truncated archive"
+    else
+        pass "refuses a truncated archive"
+    fi
+}
+
+# --- Small-LP kernel (--small-kernel) ---
+check_small_kernel() {
+    local threads
+    for threads in 1 4; do
+        "$BLENDER" --data "$DATA/example.csv" --batch "$DATA/scenarios.txt" --small-kernel \
+            --threads "$threads" --output ndjson > "$WORK/kernel.ndjson" 2> /dev/null
+        if objectives_match "$WORK/kernel.ndjson"; then
+            pass "small kernel on $threads thread(s)"
+        else
+            fail "small kernel on $threads thread(s)"
+        fi
+    done
+}
+
+# --- Embedded path (--embedded and the BLENDER_EMBEDDED build) ---
+check_embedded() {
+    if "$BLENDER" --embedded > "$WORK/embedded.txt" 2>&1 &&
+       cmp -s "$WORK/embedded.txt" "$DATA/embedded.expected"; then
+        pass "--embedded"
+    else
+        fail "--embedded"
+        diff "$DATA/embedded.expected" "$WORK/embedded.txt"
+    fi
+    # Options must not turn --embedded into something else
+    if "$BLENDER" --embedded --data "$DATA/example.csv" > "$WORK/embedded.txt" 2>&1 &&
+       cmp -s "$WORK/embedded.txt" "$DATA/embedded.expected"; then
+        pass "--embedded with other options"
+    else
+        fail "--embedded with other options"
+    fi
+    if [ -n "$EMBEDDED" ]; then
+        if "$EMBEDDED" > "$WORK/embedded.txt" 2>&1 &&
+           cmp -s "$WORK/embedded.txt" "$DATA/embedded.expected"; then
+            pass "embedded build"
+        else
+            fail "embedded build"
+            diff "$DATA/embedded.expected" "$WORK/embedded.txt"
+        fi
+    fi
+}
+
+# --- Solve service (--serve), spoken to through bash's /dev/tcp ---
+check_server() {
+    local port=${CHECK_PORT:-17071}
+    "$BLENDER" --data "$DATA/example.csv" --serve "$port" --threads 2 \
+        > /dev/null 2> "$WORK/server.log" &
+    local server=$!
+    local tries
+    for tries in $(seq 50); do
+        grep -q "^Serving on port" "$WORK/server.log" && break
+        sleep 0.1
+    done
+    if ! grep -q "^Serving on port" "$WORK/server.log"; then
+        fail "server start (see below)"
+        cat "$WORK/server.log"
+        kill "$server" 2> /dev/null
+        return
+    fi
+
+    # Requests are numbered per connection from 1; a malformed one is
+    # answered with an error under its own number
+    (
+        exec 3<> "/dev/tcp/127.0.0.1/$port" || exit 1
+        grep -v '^#' "$DATA/scenarios.txt" | sed '1a not a scenario' >&3
+        for k in 1 2 3 4; do
+            read -r -t 10 line <&3 || exit 1
+            echo "$line"
+        done
+    ) > "$WORK/server.ndjson"
+    grep -v '"error"' "$WORK/server.ndjson" > "$WORK/served.ndjson"
+    if objectives_match "$WORK/served.ndjson" "1 1040 3 1000 4 2200" &&
+       grep -q '^{"scenario":2,"error":"malformed request"}$' "$WORK/server.ndjson"; then
+        pass "server requests"
+    else
+        fail "server requests"
+        cat "$WORK/server.ndjson"
+    fi
+
+    # A line longer than the request cap closes the connection (EOF or a
+    # reset, not a timeout) and leaves the server running
+    (
+        trap '' PIPE
+        exec 3<> "/dev/tcp/127.0.0.1/$port" || exit 1
+        head -c 100000 /dev/zero | tr '\0' 1 >&3 2> /dev/null
+        read -r -t 10 line <&3
+        status=$?
+        [ "$status" -ge 1 ] && [ "$status" -le 128 ]
+    )
+    if [ $? -eq 0 ]; then
+        pass "server closes over-long requests"
+    else
+        fail "server closes over-long requests"
+    fi
+    (
+        exec 3<> "/dev/tcp/127.0.0.1/$port" || exit 1
+        grep -v '^#' "$DATA/scenarios.txt" | head -1 >&3
+        read -r -t 10 line <&3 && echo "$line"
+    ) > "$WORK/server.ndjson"
+    if objectives_match "$WORK/server.ndjson" "1 1040"; then
+        pass "server after a closed connection"
+    else
+        fail "server after a closed connection"
+    fi
+
+    kill "$server" 2> /dev/null
+    wait "$server" 2> /dev/null
+}
+
+check_loader
+check_result_cache
+check_presolve_cache
+check_archive
+check_small_kernel
+check_embedded
+check_server
+
+if [ "$failures" -gt 0 ]; then
+    echo "$failures check(s) failed"
+    exit 1
+fi
+echo "all checks passed"